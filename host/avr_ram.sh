@@ -0,0 +1,183 @@
+#!/bin/sh
+#
+# Speicherbericht fuer den ATmega32 (32 kByte Flash, 2 kByte SRAM):
+# statischer RAM-Bedarf (.data, .bss, .noinit), schlechtester Fall der
+# Stacktiefe ueber den Aufrufgraph und die verbleibende Reserve. Endet mit
+# Rueckgabewert 1, wenn die Reserve unter STACK_RESERVE Bytes (Vorgabe
+# 128) faellt.
+#
+#   host/avr_ram.sh
+#
+# Die Stackrahmen stammen aus -fstack-usage (einschl. Ruecksprungadresse),
+# fuer Bibliotheksfunktionen ohne Angabe zaehlt das Skript Ruecksprung-
+# adresse und push-Befehle. Die Aufrufe (call, rcall, Sprung an einen
+# Funktionsanfang) liest es aus der Disassemblierung, icall ruft jede
+# Aufgabe aus task_fn[] auf. Interruptroutinen (SIGNAL) laufen mit
+# gesperrten Interrupts, zum Stack von main kommt also hoechstens die
+# tiefste hinzu. Gibt eine Routine mit sei Interrupts frei, werden alle
+# addiert.
+#
+# Auf dem Geraet liefert Befehl 106 (USART) zur Kontrolle, wieviele Bytes
+# der Stack seit dem Start nie beschrieben hat (stack_unused()).
+#
+# Benoetigt avr-gcc, avr-size und avr-objdump. Zusaetzliche Compiler-
+# optionen in AVR_CFLAGS, z.B. -DDECO_FIXPOINT.
+
+cd "$(dirname "$0")/.." || exit 1
+
+dir=${TMPDIR:-/tmp}/sbtc3b_avr
+src=open_source_dive_computer.c
+mcu=atmega32
+ram=2048
+flash=32768
+reserve=${STACK_RESERVE:-128}
+
+mkdir -p "$dir" || exit 1
+
+avr-gcc -mmcu=$mcu -Os -DF_CPU=8000000UL -fstack-usage $AVR_CFLAGS \
+    -c -o "$dir/sbtc3b.o" $src || exit 1
+avr-gcc -mmcu=$mcu -o "$dir/sbtc3b.elf" "$dir/sbtc3b.o" -lm || exit 1
+avr-objdump -d "$dir/sbtc3b.elf" > "$dir/sbtc3b.lst" || exit 1
+if [ ! -s "$dir/sbtc3b.su" ]
+then
+    echo "Keine Stackrahmen von -fstack-usage" >&2
+    exit 1
+fi
+
+set -- $(avr-size -A "$dir/sbtc3b.elf" | awk '
+    $1 == ".text"   { text = $2 }
+    $1 == ".data"   { data = $2 }
+    $1 == ".bss"    { bss = $2 }
+    $1 == ".noinit" { noinit = $2 }
+    END { print text + 0, data + 0, bss + 0, noinit + 0 }')
+text=$1 data=$2 bss=$3 noinit=$4
+static=$((data + bss + noinit))
+
+printf "Flash:       %5d von %5d Bytes (.text %d, .data %d)\n" $((text + data)) $flash $text $data
+printf "SRAM:        %5d von %5d Bytes (.data %d, .bss %d, .noinit %d)\n" $static $ram $data $bss $noinit
+printf "Frei fuer Stack: %d Bytes\n\n" $((ram - static))
+
+echo "Groesste Stackrahmen [Bytes]:"
+sort -t "$(printf '\t')" -k 2 -n -r "$dir/sbtc3b.su" | head -n 8 |
+    awk -F '\t' '{ n = split($1, f, ":"); printf "  %5d  %s\n", $2, f[n] }'
+echo
+
+# Ziele von icall: die Aufgaben in task_fn[]
+indirect=$(sed -n '/(\*task_fn\[/,/};/p' $src | sed 's/.*{//; s/}.*//' | tr -d ' \n' | tr ',' ' ')
+
+awk -v free=$((ram - static)) -v reserve=$reserve -v indirect="$indirect" '
+    # .su: Datei:Zeile:Spalte:Name, Bytes, static/dynamic
+    FNR == NR {
+        split($0, f, "\t")
+        n = split(f[1], g, ":")
+        su[g[n]] = f[2] + 0
+        if(f[3] !~ /^static/)
+            dyn = dyn " " g[n]
+        next
+    }
+
+    # Disassemblierung: Funktionsanfang
+    /^[0-9a-f]+ <[^>]+>:$/ {
+        fn = $2
+        gsub(/[<>:]/, "", fn)
+        push[fn] = 0
+        if(fn ~ /^__vector_[0-9]+$/)
+            isr[++isrs] = fn
+        next
+    }
+    fn == "" { next }
+    /\tpush\t/ { push[fn]++ }
+    /\tsei/ { sei[fn] = 1 }
+    /\ti(call|jmp)/ { calls[fn] = calls[fn] " " indirect }
+    /\t(r?call|r?jmp)\t/ && match($0, /<[^>+]+>$/) {
+        t = substr($0, RSTART + 1, RLENGTH - 2)
+        if(t != fn)
+            calls[fn] = calls[fn] " " t
+    }
+
+    function frame(f)
+    {
+        return f in su ? su[f] : 2 + push[f]
+    }
+
+    # Tiefster Stack ab f, Nachfolger im tiefsten Pfad in via[f]
+    function depth(f,    c, n, i, d, best)
+    {
+        if(f in memo)
+            return memo[f]
+        if(f in busy)
+        {
+            recursion = recursion " " f
+            return 0
+        }
+        busy[f] = 1
+        best = 0
+        via[f] = ""
+        has_sei[f] = f in sei
+        n = split(calls[f], c, " ")
+        for(i = 1; i <= n; i++)
+        {
+            d = depth(c[i])
+            if(has_sei[c[i]])
+                has_sei[f] = 1
+            if(d > best)
+            {
+                best = d
+                via[f] = c[i]
+            }
+        }
+        delete busy[f]
+        return memo[f] = frame(f) + best
+    }
+
+    function path(f,    s)
+    {
+        for(s = f; via[f] != ""; s = s " > " f)
+            f = via[f]
+        return s
+    }
+
+    END {
+        if(!("main" in push))
+        {
+            print "Fehler: main fehlt in der Disassemblierung"
+            exit 1
+        }
+
+        # stack_paint() laeuft vor dem Stack, ohne eigenen Rahmen
+        if(push["stack_paint"] || su["stack_paint"])
+        {
+            print "Fehler: stack_paint() legt einen Stackrahmen an"
+            exit 1
+        }
+
+        total = depth("main")
+        printf "Stack main:   %5d Bytes  %s\n", total, path("main")
+
+        for(i = 1; i <= isrs; i++)
+        {
+            d = depth(isr[i])
+            printf "Stack ISR %2s %5d Bytes  %s\n", substr(isr[i], 10), d, path(isr[i])
+            isr_sum += d
+            if(d > isr_max)
+                isr_max = d
+            if(has_sei[isr[i]])
+                nested = 1
+        }
+
+        total += nested ? isr_sum : isr_max
+        printf "\nStack gesamt: %d Bytes (%s)\n", total,
+            nested ? "Interrupts verschachtelt" : "main + tiefste Interruptroutine"
+        printf "Reserve:      %d Bytes (mindestens %d)\n", free - total, reserve
+
+        if(recursion != "")
+            print "Warnung: Rekursion nicht erfasst:" recursion
+        if(dyn != "")
+            print "Warnung: dynamische Stackrahmen:" dyn
+
+        exit free - total < reserve
+    }' "$dir/sbtc3b.su" "$dir/sbtc3b.lst"
+ret=$?
+
+rm -rf "$dir"
+exit $ret
@@ -0,0 +1,39 @@
+#!/bin/sh
+#
+# Laufzeitmessung der Hauptschleife fuer alle Profile in host/profiles.
+# Vergleicht mit den Referenzwerten in host/profiles/*.ref und endet mit
+# Rueckgabewert 1, wenn ein Abschnitt mehr als 1 % langsamer geworden ist
+# oder ein Durchlauf erstmals das Budget von 1 s ueberschreitet.
+#
+#   host/bench.sh       messen und vergleichen
+#   host/bench.sh -w    Referenzwerte neu schreiben (nach gewollten Aenderungen)
+#
+# Zusaetzliche Compileroptionen in BENCH_CFLAGS, z.B. -DDECO_FIXPOINT.
+# Die Referenzwerte gelten fuer den Standard-Build (float).
+
+cd "$(dirname "$0")/.." || exit 1
+
+bin=${TMPDIR:-/tmp}/sbtc3b_bench
+out=$bin.out
+
+g++ -O2 -x c++ -DHOST_SIM -DSIM_BENCH $BENCH_CFLAGS -Ihost -w -o "$bin" open_source_dive_computer.c host/host_sim.c -lm || exit 1
+
+ret=0
+for p in host/profiles/*.txt
+do
+    ref=${p%.txt}.ref
+    echo "== $p"
+
+    if [ "$1" = "-w" ]
+    then
+        "$bin" -b -w "$ref" "$p" > "$out"
+    elif ! "$bin" -b -c "$ref" "$p" > "$out"
+    then
+        ret=1
+    fi
+
+    sed -n '/^Laufzeiten/,$p' "$out"
+done
+
+rm -f "$bin" "$out"
+exit $ret
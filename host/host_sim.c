@@ -0,0 +1,1172 @@
+//***************************************************************//
+//  Simulation des SBTC3b auf dem PC                              //
+//  ************************************************************ //
+//  Bildet die Hardware-Funktionen der Firmware (HAL) nach und    //
+//  laesst die unveraenderte Hauptschleife mit einem Tiefen- und  //
+//  Temperaturprofil aus einer Textdatei schneller als in         //
+//  Echtzeit laufen.                                              //
+//***************************************************************//
+//
+// Uebersetzen (aus dem Hauptverzeichnis):
+//
+//   gcc -O2 -DHOST_SIM -Ihost -Wno-int-to-pointer-cast -o sbtc3b_sim open_source_dive_computer.c host/host_sim.c -lm
+//
+// Fuer die Laufzeitmessung mit Gleitkomma-Kostenmodell (siehe sim_float.h)
+// als C++ und mit SIM_BENCH, host/bench.sh erledigt das fuer alle Profile
+// in host/profiles:
+//
+//   g++ -O2 -x c++ -DHOST_SIM -DSIM_BENCH -Ihost -w -o sbtc3b_bench open_source_dive_computer.c host/host_sim.c -lm
+//
+// Aufruf:
+//
+//   ./sbtc3b_sim [-l] [-s] [-b] [-c datei] [-w datei] [-e eeprom.bin] [-u Volt] profil.txt
+//
+//   -l  Displayinhalt und LEDs bei jeder Aenderung ausgeben
+//       (vor jeder Tastenabfrage und jedem Schlafen)
+//   -s  Von der USART gesendete Bytes ausgeben
+//   -b  Laufzeiten der Abschnitte der Hauptschleife ausgeben
+//   -c  Laufzeiten mit einer Referenzdatei vergleichen, Rueckgabewert 2
+//       bei mehr als 1 % Verschlechterung eines Abschnitts oder wenn ein
+//       Durchlauf erstmals laenger als 1 s dauert
+//   -w  Laufzeiten als Referenzdatei schreiben
+//   -e  EEPROM-Abbild laden und am Ende zurueckschreiben
+//       (fuer Wiederholungstauchgaenge ueber mehrere Laeufe),
+//       ohne Abbild beginnt die Simulation mit geloeschtem Speicher
+//   -u  Akkuspannung (Vorgabe 4.8 V)
+//
+// Profildatei, eine Angabe pro Zeile, '#' leitet Kommentare ein.
+// Zeiten in Sekunden oder als [h:]mm:ss seit Programmstart:
+//
+//   <Zeit> <Tiefe m> [<Temperatur C>]   Stuetzpunkt, dazwischen wird
+//                                       linear interpoliert
+//   T <Zeit> <Taste 1-3> [<Dauer s>]    Taste druecken (Vorgabe 0.5 s)
+//   U <Zeit> <Byte> [<Byte> ...]        Bytes ueber die USART empfangen
+//   B <Baud>                            Baudrate des PCs fuer die folgenden
+//                                       U-Zeilen (Vorgabe 2262 wie der SBTC),
+//                                       weicht sie mehr als 2 % ab, empfaengt
+//                                       der SBTC verfaelschte Bytes
+//
+// Die Simulation endet mit dem letzten Eintrag der Profildatei.
+//
+// Zeitmodell: Die Simulation zaehlt Taktzyklen des ATmega32 bei 8 MHz.
+// Warteschleifen (delay_ms), Display, AD-Wandler, USART (Sendedauer je
+// nach eingestellter Baudrate) und EEPROM (8.5 ms pro Schreibzugriff, Warten auf das
+// Ende des vorherigen) werden mit ihrer Dauer auf dem AVR angesetzt,
+// im SIM_BENCH-Build zusaetzlich jede Gleitkommaoperation. Die uebrige
+// Ganzzahlrechnung der Firmware wird nicht nachgebildet. Timer 2 loest
+// viermal pro Sekunde SIG_OVERFLOW2 aus, power_save() schlaeft bis zum
+// naechsten Termin des Aufgabenplaners. Die gefilterte Tiefe und Aufstiegsgeschwin-
+// digkeit der Firmware werden dabei jede Sekunde mit dem Profil verglichen.
+// Achtung: int hat auf dem PC 32 statt 16 Bit, Ueberlaeufe der
+// Firmware treten daher nicht genauso auf.
+
+#define HOST_SIM_IMPL
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "host_sim.h"
+
+#define SIM_MAX_POINTS 4096
+#define SIM_MAX_KEYS 256
+#define SIM_MAX_RX 4096
+#define EEPROM_SIZE 1024
+
+// Taktzyklen
+#define CPU_HZ 8000000ULL
+#define CYC_MS (CPU_HZ / 1000)
+#define TIMER_TICK_CYC (CPU_HZ / 4)              // TICKS_PER_S der Firmware
+#define USART_BYTE_CYC(ubrr) (10ULL * 8 * ((ubrr) + 1))  // 10 Bit mit U2X
+#define USART_BAUD(ubrr) ((double) CPU_HZ / (8 * ((ubrr) + 1)))
+#define USART_UBRR_INIT 441                      // Grundrate 2262 Baud
+#define USART_BAUD_TOL 0.02                      // zulaessige Abweichung PC - SBTC
+#define EEPROM_WRITE_CYC (CYC_MS * 17 / 2)       // 8.5 ms
+#define EEPROM_ENDURANCE 100000.0                // Schreibzugriffe je Zelle (Datenblatt)
+#define LCD_WRITE_CYC 40                         // Portzugriffe in lcd_write()
+#define LCD_EXEC_CYC (CPU_HZ / 1000000 * 37)      // Ausfuehrungszeit HD44780 (37 us)
+#define LCD_DELAY_CYC (CPU_HZ / 1000000 * 50)     // LCD_EXEC_US der Firmware
+#define KEYS_CYC 50
+#define ADC_CONV_CYC (64 * 13)                   // Wandlung, ADC-Takt = CPU-Takt / 64
+#define ADC_FIRST_CYC (64 * 25)                  // erste Wandlung nach dem Einschalten
+#define ADC_NOISE 1.0                            // Rauschen [LSB], Dreiecksverteilung
+#define BENCH_TOLERANCE 1.01
+#define DFLT_CYC 156                             // depth_filter() mit call (AVR-Listing ausgezaehlt)
+#define DFLT_REPLAY 1000                         // Wiederholungen der Tiefenfolge
+
+// Hardware-Funktionen der Firmware (HAL)
+void ports_init(void);
+void watchdog_off(void);
+void timer_init(void);
+void timer_reload(void);
+void power_save(unsigned long);
+unsigned char timer_count(void);
+void adc_start(char);
+int adc_read(void);
+void adc_off(void);
+void adc_sleep(void);
+void lcd_write(char, unsigned char, int);
+void lcd_flush(void);
+void led(char, char);
+int get_keys(void);
+void delay_ms(int);
+void usart_init(void);
+void usart_off(void);
+char usart_getc(void);
+void usart_write(char);
+void usart_tx_on(void);
+void usart_tx_off(void);
+char usart_tx_done(void);
+void usart_baud(unsigned int);
+void ee_rdy_on(void);
+void ee_rdy_off(void);
+
+// Sekundenzaehler, Sende- und EEPROM-Puffer der Firmware
+extern unsigned long runseconds;
+extern unsigned char tx_buf_max;
+extern unsigned int tx_dropped;
+extern unsigned char ee_queue_max;
+extern unsigned int log_dives, log_minutes, log_maxdepth;
+extern unsigned char lcd_timing;
+extern int depth, depth_rate;
+extern unsigned char ascent_fast;
+extern volatile long dflt_x, dflt_v;
+extern volatile unsigned char dflt_init;
+void depth_filter(unsigned int);
+extern unsigned int task_runs[], task_missed[], task_time_max[];
+
+// Taktzyklen der Soft-Float-Routinen der avr-libc (Richtwerte, Mittel
+// ueber typische Operanden), Reihenfolge wie FOP_* in host_sim.h
+unsigned int fop_cycles[FOPS] = {110, 150, 480, 60, 80, 2700, 2400, 5100, 500, 50};
+const char *fop_name[FOPS] = {"add", "mul", "div", "cmp", "conv", "exp", "log", "pow", "sqrt", "misc"};
+
+// Aufgaben der Firmware (TASK_*, TASKS)
+#define SIM_TASKS 7
+const char *task_name[SIM_TASKS] = {"sensoren", "tg", "anzeige", "gewebe", "deko", "profil", "tasten"};
+
+const char *bench_name[BENCH_SECTIONS] = {"schleife", "dsensor", "ppo2", "anzeige", "tsensor",
+    "inertgas", "deko", "zns_otu", "eeprom", "lcd", "tasten"};
+
+// Profil
+struct sim_point
+{
+    unsigned long t;  // [ms]
+    double depth;     // [m]
+    double temp;      // [C]
+} sim_pt[SIM_MAX_POINTS];
+int sim_pt_cnt = 0, sim_pt_cur = 0;
+
+struct sim_key
+{
+    unsigned long t, dur;  // [ms]
+    int key;
+} sim_keys[SIM_MAX_KEYS];
+int sim_key_cnt = 0;
+
+struct sim_rx
+{
+    unsigned long long t;  // [Takte]
+    double baud;           // Baudrate des PCs
+    unsigned char byte;
+} sim_rxq[SIM_MAX_RX];
+int sim_rx_cnt = 0, sim_rx_next = 0;
+
+// Zustand der Simulation
+unsigned long long sim_cyc = 0;          // Simulierte Zeit [Takte]
+unsigned long long sim_next_ev = ~0ULL;  // Naechstes Ereignis (Timer, USART, Ende)
+unsigned long long sim_tick = 0;         // Naechster Ueberlauf von Timer 2
+unsigned long long sim_end = 0;
+unsigned long long sim_sleep_cyc = 0;    // davon im Energiesparmodus
+unsigned long sim_end_ms = 0;
+char sim_in_isr = 0, sim_sleeping = 0;
+char timer_on = 0, usart_on = 0;
+int adc_sample = 0;
+char adc_on = 0, adc_conv = 0;           // eingeschaltet, Wandlung laeuft
+unsigned long long adc_ready = 0;        // Ende der Wandlung [Takte]
+unsigned int sim_rand_state = 1;
+unsigned char rx_byte = 0;
+char tx_udrie = 0;                       // UDRE-Interrupt eingeschaltet
+unsigned long long tx_udre = 0;          // UDR wieder frei [Takte]
+unsigned long long tx_shift = 0;         // Schieberegister wieder frei [Takte]
+unsigned int usart_ubrr = USART_UBRR_INIT;
+unsigned long rx_dropped = 0, rx_errors = 0, tx_cnt = 0;
+double accu_volt = 4.8;
+
+// Display 2x16, Adressen 0x00-0x0F und 0x40-0x4F
+char lcd_ram[2][16], lcd_shown[2][16];
+unsigned char lcd_adr = 0, lcd_inc = 1;
+unsigned long lcd_bytes = 0, lcd_frames = 0;     // gesendete Bytes, Bilder (lcd_flush())
+unsigned long long lcd_cyc = 0, lcd_frame_cyc = 0, lcd_frame_max = 0, lcd_last = 0;
+char led_on[5], led_shown[5];
+
+// Tiefenfilter gegen das Profil, einmal pro Sekunde unter Wasser
+double dflt_err_max = 0;                 // max. Abweichung der Tiefe [m]
+double dflt_asc_max = 0, prof_asc_max = 0;  // max. Aufstiegsgeschw. Filter, Profil [m/min]
+unsigned long dflt_warnings = 0;         // Aufstiegswarnungen
+char dflt_warn_last = 0;
+
+unsigned char eeprom_mem[EEPROM_SIZE];
+unsigned long eeprom_writes = 0;
+unsigned long eeprom_cell_writes[EEPROM_SIZE];   // Schreibzugriffe je Zelle
+long sim_dives0 = -1;                    // log_dives beim ersten power_save()
+unsigned long long eeprom_busy = 0;      // Ende des laufenden Schreibzugriffs [Takte]
+char ee_rdie = 0;                        // EE_RDY-Interrupt eingeschaltet
+char *eeprom_file = NULL;
+
+// Laufzeitmessung
+struct bench_stat
+{
+    unsigned long n;                     // Durchlaeufe, in denen der Abschnitt lief
+    unsigned long long sum, max;         // [Takte]
+    unsigned long t_max;                 // Zeitpunkt des Maximums [ms]
+} bench_stat[BENCH_SECTIONS + 1];        // + 1: ganzer Durchlauf ohne BENCH_KEYS
+unsigned long long bench_cyc[BENCH_SECTIONS];
+unsigned long bench_over = 0;            // Durchlaeufe ueber dem Budget von 1 s
+unsigned long fop_cnt[FOPS];
+int bench_cur = BENCH_LOOP;
+char bench_on = 0;
+
+char opt_lcd = 0, opt_usart = 0, opt_bench = 0;
+char *bench_cmp_file = NULL, *bench_ref_file = NULL;
+struct timespec wall_start;
+
+//***************************
+// Ablauf der Simulation
+//***************************
+void sim_finish(void);
+
+unsigned long sim_ms(void)
+{
+    return sim_cyc / CYC_MS;
+}
+
+void sim_next_event(void)
+{
+    sim_next_ev = sim_end;
+    if(timer_on && sim_tick < sim_next_ev)
+        sim_next_ev = sim_tick;
+    if(sim_rx_next < sim_rx_cnt && sim_rxq[sim_rx_next].t < sim_next_ev)
+        sim_next_ev = sim_rxq[sim_rx_next].t;
+    if(usart_on && tx_udrie && tx_udre < sim_next_ev)
+        sim_next_ev = tx_udre;
+    if(ee_rdie && eeprom_busy < sim_next_ev)
+        sim_next_ev = eeprom_busy;
+    if(adc_conv && adc_ready < sim_next_ev)
+        sim_next_ev = adc_ready;
+}
+
+// Interruptroutine aufrufen, keine Verschachtelung wie auf dem AVR
+void sim_isr(void (*isr)(void))
+{
+    sim_in_isr = 1;
+    isr();
+    sim_in_isr = 0;
+}
+
+// Simulierte Zeit um cyc Taktzyklen weiterschalten und dabei
+// faellige Interrupts ausloesen
+void sim_run(unsigned long long cyc)
+{
+    unsigned long long target = sim_cyc + cyc;
+
+    if(bench_on && !sim_sleeping)
+        bench_cyc[bench_cur] += cyc;
+
+    if(sim_in_isr || target < sim_next_ev)
+    {
+        sim_cyc = target;
+        return;
+    }
+
+    while(sim_next_ev <= target)
+    {
+        if(sim_next_ev > sim_cyc)
+            sim_cyc = sim_next_ev;
+
+        if(sim_cyc >= sim_end)
+            sim_finish();
+
+        if(timer_on && sim_cyc >= sim_tick)
+        {
+            sim_tick += TIMER_TICK_CYC;
+            sim_isr(sim_isr_timer2);
+        }
+
+        while(sim_rx_next < sim_rx_cnt && sim_rxq[sim_rx_next].t <= sim_cyc)
+        {
+            if(usart_on)
+            {
+                // Bei abweichender Baudrate kommt Unsinn an
+                rx_byte = sim_rxq[sim_rx_next].byte;
+                if(fabs(sim_rxq[sim_rx_next].baud / USART_BAUD(usart_ubrr) - 1) > USART_BAUD_TOL)
+                {
+                    rx_byte ^= 0xA5;
+                    rx_errors++;
+                }
+                sim_isr(sim_isr_uart_recv);
+            }
+            else
+                rx_dropped++;
+            sim_rx_next++;
+        }
+
+        if(usart_on && tx_udrie && sim_cyc >= tx_udre)
+            sim_isr(sim_isr_uart_data);
+
+        if(ee_rdie && sim_cyc >= eeprom_busy)
+            sim_isr(sim_isr_ee_rdy);
+
+        if(adc_conv && sim_cyc >= adc_ready)
+        {
+            adc_conv = 0;
+            sim_isr(sim_isr_adc);
+        }
+
+        sim_next_event();
+    }
+
+    sim_cyc = target;
+}
+
+void sim_fop(int op)
+{
+    fop_cnt[op]++;
+    sim_run(fop_cycles[op]);
+}
+
+void sim_bench_section(int s)
+{
+    bench_on = 1;
+    bench_cur = s;
+}
+
+// Schleifendurchlauf abschliessen (vor power_save())
+void sim_bench_loop(void)
+{
+    unsigned long long total = 0;
+    int t1;
+
+    if(!bench_on)
+        return;
+
+    for(t1 = 0; t1 < BENCH_SECTIONS; t1++)
+    {
+        if(t1 != BENCH_KEYS)
+            total += bench_cyc[t1];
+    }
+
+    for(t1 = 0; t1 <= BENCH_SECTIONS; t1++)
+    {
+        unsigned long long c = t1 < BENCH_SECTIONS ? bench_cyc[t1] : total;
+        struct bench_stat *b = &bench_stat[t1];
+
+        if(!c)
+            continue;
+
+        b->n++;
+        b->sum += c;
+        if(c > b->max)
+        {
+            b->max = c;
+            b->t_max = sim_ms();
+        }
+    }
+
+    if(total > CPU_HZ)
+        bench_over++;
+
+    memset(bench_cyc, 0, sizeof(bench_cyc));
+    bench_cur = BENCH_LOOP;
+}
+
+void sim_print_time(unsigned long ms)
+{
+    unsigned long s = ms / 1000;
+
+    printf("%02lu:%02lu:%02lu", s / 3600, s / 60 % 60, s % 60);
+}
+
+// Display und LEDs ausgeben, falls sich etwas geaendert hat
+void sim_show_lcd(void)
+{
+    int t1, c;
+
+    if(!memcmp(lcd_ram, lcd_shown, sizeof(lcd_ram)) && !memcmp(led_on, led_shown, sizeof(led_on)))
+        return;
+
+    memcpy(lcd_shown, lcd_ram, sizeof(lcd_ram));
+    memcpy(led_shown, led_on, sizeof(led_on));
+
+    sim_print_time(sim_ms());
+    printf(" |");
+    for(t1 = 0; t1 < 32; t1++)
+    {
+        c = (unsigned char) lcd_shown[t1 / 16][t1 % 16];
+        if(c == 0xDF)          // Gradzeichen im Zeichensatz des HD44780
+            c = 'o';
+        else if(c < 32 || c > 126)
+            c = '?';
+        printf(t1 == 15 ? "%c|" : "%c", c);
+    }
+    printf("| LED");
+    for(t1 = 2; t1 < 5; t1++)
+        printf(" %c", led_shown[t1] ? '*' : '.');
+    printf("\n");
+}
+
+// Tiefenfilter: alle Tiefenwerte des Profils (TICKS_PER_S pro Sekunde, 
+// wie SIG_ADC) DFLT_REPLAY mal durch depth_filter() schicken und die Zeit
+// pro Wert messen. Der Filterzustand der Firmware bleibt erhalten.
+void sim_dflt_replay(void)
+{
+    struct timespec t0, t1;
+    unsigned long n = 0, i, ms, end = sim_pt[sim_pt_cnt - 1].t;
+    long x = dflt_x, v = dflt_v;
+    unsigned char init = dflt_init;
+    unsigned int *z;
+    int pt, rep;
+    double ns;
+
+    z = (unsigned int*) malloc((end / 250 + 1) * sizeof(*z));
+    if(!z)
+        return;
+    for(ms = pt = 0; ms <= end; ms += 250)
+    {
+        while(pt < sim_pt_cnt - 1 && sim_pt[pt + 1].t <= ms)
+            pt++;
+        if(pt == sim_pt_cnt - 1)
+            z[n++] = sim_pt[pt].depth * 40 + 0.5;
+        else
+            z[n++] = (sim_pt[pt].depth + (sim_pt[pt + 1].depth - sim_pt[pt].depth)
+                * (ms - sim_pt[pt].t) / (sim_pt[pt + 1].t - sim_pt[pt].t)) * 40 + 0.5;
+    }
+
+    dflt_init = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(rep = 0; rep < DFLT_REPLAY; rep++)
+        for(i = 0; i < n; i++)
+            depth_filter(z[i]);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ((double) n * DFLT_REPLAY);
+
+    dflt_x = x;
+    dflt_v = v;
+    dflt_init = init;
+    free(z);
+
+    printf("Tiefenfilter je Wert: %lu Werte, PC %.1f ns, AVR ca. %d Takte (%.3f %% bei 4 Werten/s)\n",
+        n, ns, DFLT_CYC, 100.0 * DFLT_CYC * 4 / CPU_HZ);
+}
+
+void bench_report(void)
+{
+    struct bench_stat *b;
+    int t1;
+
+    printf("\nLaufzeiten pro Durchlauf der Hauptschleife, Budget 1 s = %llu Takte\n", CPU_HZ);
+    printf("Abschnitt   Durchl.  Mittel [Takte]    Max [Takte]  Max [ms]  Zeitpunkt\n");
+    for(t1 = 0; t1 <= BENCH_SECTIONS; t1++)
+    {
+        b = &bench_stat[t1];
+        if(t1 == BENCH_SECTIONS)
+            printf("gesamt    ");
+        else
+            printf("%-10s", bench_name[t1]);
+        printf(" %8lu %15llu %14llu %9.1f  ", b->n, b->n ? b->sum / b->n : 0, b->max, (double) b->max / CYC_MS);
+        sim_print_time(b->t_max);
+        printf(t1 == BENCH_KEYS ? "  (nicht im Budget)\n" : "\n");
+    }
+    printf("Max. Auslastung: %.1f %%, Durchlaeufe ueber 1 s: %lu\n", 100.0 * bench_stat[BENCH_SECTIONS].max / CPU_HZ, bench_over);
+
+    printf("Gleitkommaoperationen:");
+    for(t1 = 0; t1 < FOPS; t1++)
+        printf(" %s %lu", fop_name[t1], fop_cnt[t1]);
+#ifndef SIM_BENCH
+    printf(" (ohne SIM_BENCH nicht erfasst)");
+#endif
+    printf("\n");
+    sim_dflt_replay();
+}
+
+// Referenzdatei: eine Zeile "<Abschnitt> <Max. Takte>" pro Abschnitt
+void bench_write(char *fname)
+{
+    FILE *f = fopen(fname, "w");
+    int t1;
+
+    if(!f)
+    {
+        perror(fname);
+        return;
+    }
+    for(t1 = 0; t1 <= BENCH_SECTIONS; t1++)
+        fprintf(f, "%s %llu\n", t1 < BENCH_SECTIONS ? bench_name[t1] : "gesamt", bench_stat[t1].max);
+    fclose(f);
+}
+
+// Rueckgabe 1, wenn ein Abschnitt langsamer geworden ist oder das Budget
+// nicht mehr reicht
+int bench_compare(char *fname)
+{
+    FILE *f = fopen(fname, "r");
+    char name[32];
+    unsigned long long ref, cur, ref_total = 0;
+    int t1, fail = 0;
+
+    if(!f)
+    {
+        perror(fname);
+        return 1;
+    }
+
+    while(fscanf(f, "%31s %llu", name, &ref) == 2)
+    {
+        for(t1 = 0; t1 <= BENCH_SECTIONS; t1++)
+            if(!strcmp(name, t1 < BENCH_SECTIONS ? bench_name[t1] : "gesamt"))
+                break;
+        if(t1 > BENCH_SECTIONS)
+            continue;
+
+        cur = bench_stat[t1].max;
+        if(t1 == BENCH_SECTIONS)
+            ref_total = ref;
+        if(cur > ref * BENCH_TOLERANCE)
+        {
+            printf("Langsamer: %s %llu -> %llu Takte (+%.1f %%)\n", name, ref, cur, ref ? 100.0 * cur / ref - 100 : 100.0);
+            fail = 1;
+        }
+    }
+    fclose(f);
+
+    if(bench_stat[BENCH_SECTIONS].max > CPU_HZ && ref_total <= CPU_HZ)
+    {
+        printf("Budget ueberschritten: %llu Takte\n", bench_stat[BENCH_SECTIONS].max);
+        fail = 1;
+    }
+
+    return fail;
+}
+
+void sim_finish(void)
+{
+    struct timespec wall_end;
+    double wall;
+    FILE *f;
+    int ret = 0, t1, hot;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    wall = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) * 1e-9;
+
+    // Letzten Displayinhalt immer ausgeben
+    memset(lcd_shown, 0, sizeof(lcd_shown));
+    sim_show_lcd();
+
+    if(eeprom_file)
+    {
+        f = fopen(eeprom_file, "wb");
+        if(f)
+        {
+            fwrite(eeprom_mem, 1, EEPROM_SIZE, f);
+            fclose(f);
+        }
+        else
+            perror(eeprom_file);
+    }
+
+    printf("Simulierte Zeit:     ");
+    sim_print_time(sim_ms());
+    printf(" (%lu s Timer)\n", runseconds);
+    printf("Laufzeit PC:         %.3f s (Faktor %.0f)\n", wall, wall > 0 ? sim_ms() * 0.001 / wall : 0);
+    printf("Wach (ohne Schlaf):  %.1f %%\n", sim_cyc ? 100.0 * (sim_cyc - sim_sleep_cyc) / sim_cyc : 0);
+    printf("Tauchgaenge:         %u\n", log_dives);
+    printf("Gesamttauchzeit:     %u min\n", log_minutes);
+    printf("Max. Tiefe:          %.1f m\n", log_maxdepth * 0.1);
+    printf("Tiefenfilter:        max. %.2f m Abweichung, Aufstieg max. %.1f m/min (Profil %.1f), %lu Warnungen\n",
+        dflt_err_max, dflt_asc_max, prof_asc_max, dflt_warnings);
+    printf("EEPROM-Schreibzugr.: %lu\n", eeprom_writes);
+    for(t1 = hot = 0; t1 < EEPROM_SIZE; t1++)
+        if(eeprom_cell_writes[t1] > eeprom_cell_writes[hot])
+            hot = t1;
+    printf("EEPROM-Verschleiss:  max. %lu Schreibzugr. auf Adresse %d\n", eeprom_cell_writes[hot], hot);
+    if(sim_dives0 >= 0 && log_dives > sim_dives0 && eeprom_cell_writes[hot])
+        printf("EEPROM-Lebensdauer:  ca. %.0f TG (%.0f Schreibzugr. je Zelle, %ld TG simuliert)\n",
+            EEPROM_ENDURANCE * (log_dives - sim_dives0) / eeprom_cell_writes[hot], EEPROM_ENDURANCE,
+            log_dives - sim_dives0);
+    printf("USART gesendet:      %lu Bytes, %lu empfangene verworfen, %lu mit falscher Baudrate\n",
+        tx_cnt, rx_dropped, rx_errors);
+    printf("Sendepuffer:         max. %u Bytes, %u verworfen\n", tx_buf_max, tx_dropped);
+    printf("EEPROM-Puffer:       max. %u Bytes\n", ee_queue_max);
+    printf("Display:             %lu Bytes in %lu Bildern, %.2f ms pro Bild, max. %.2f ms (LCD_TIMING %d)\n",
+        lcd_bytes, lcd_frames, lcd_frames ? (double) lcd_cyc / lcd_frames / CYC_MS : 0,
+        (double) lcd_frame_max / CYC_MS, lcd_timing);
+
+    printf("Aufgaben:            ");
+    for(t1 = 0; t1 < SIM_TASKS; t1++)
+        printf("%s%s %u", t1 ? ", " : "", task_name[t1], task_runs[t1]);
+    printf(" Aufrufe\n");
+    printf("  verpasst:          ");
+    for(t1 = 0; t1 < SIM_TASKS; t1++)
+        printf("%s%s %u", t1 ? ", " : "", task_name[t1], task_missed[t1]);
+    printf("\n  max. Laufzeit:     ");
+    for(t1 = 0; t1 < SIM_TASKS; t1++)
+        printf("%s%s %.0f", t1 ? ", " : "", task_name[t1], task_time_max[t1] * (1000.0 / 1024));
+    printf(" ms\n");
+
+    if(opt_bench)
+        bench_report();
+    if(bench_ref_file)
+        bench_write(bench_ref_file);
+    if(bench_cmp_file && bench_compare(bench_cmp_file))
+        ret = 2;
+
+    exit(ret);
+}
+
+//***************************
+// Hardware-Nachbildung
+//***************************
+void ports_init(void)
+{
+}
+
+void watchdog_off(void)
+{
+}
+
+void timer_init(void)
+{
+    timer_on = 1;
+    sim_tick = sim_cyc + TIMER_TICK_CYC;
+    sim_next_event();
+}
+
+void timer_reload(void)
+{
+}
+
+unsigned char timer_count(void)
+{
+    unsigned long long left = sim_tick > sim_cyc ? sim_tick - sim_cyc : 0;
+
+    return left >= TIMER_TICK_CYC ? 0 : 255 - left * 256 / TIMER_TICK_CYC;
+}
+
+void sim_filter_check(void);
+
+// Bis runseconds = until schlafen
+void power_save(unsigned long until)
+{
+    unsigned long long cyc;
+
+    if(opt_lcd)
+        sim_show_lcd();
+
+    sim_bench_loop();
+    sim_filter_check();
+    if(sim_dives0 < 0)
+        sim_dives0 = log_dives;
+
+    sim_sleeping = 1;
+    while(runseconds < until)
+    {
+        cyc = sim_tick > sim_cyc ? sim_tick - sim_cyc : 0;
+        sim_sleep_cyc += cyc;
+        sim_run(cyc);
+    }
+    sim_sleeping = 0;
+}
+
+// Tiefe und Temperatur zum aktuellen Zeitpunkt interpolieren
+void sim_profile(double *d, double *temp)
+{
+    struct sim_point *p0, *p1;
+    unsigned long ms = sim_ms();
+    double x;
+
+    while(sim_pt_cur < sim_pt_cnt - 1 && sim_pt[sim_pt_cur + 1].t <= ms)
+        sim_pt_cur++;
+
+    p0 = &sim_pt[sim_pt_cur];
+    if(sim_pt_cur == sim_pt_cnt - 1 || ms <= p0->t)
+    {
+        *d = p0->depth;
+        *temp = p0->temp;
+        return;
+    }
+
+    p1 = p0 + 1;
+    x = (double) (ms - p0->t) / (p1->t - p0->t);
+    *d = p0->depth + x * (p1->depth - p0->depth);
+    *temp = p0->temp + x * (p1->temp - p0->temp);
+}
+
+// Gefilterte Tiefe und Geschwindigkeit der Firmware mit dem Profil vergleichen
+void sim_filter_check(void)
+{
+    struct sim_point *p0 = &sim_pt[sim_pt_cur];
+    double d, temp, rate = 0;
+
+    sim_profile(&d, &temp);
+    if(sim_pt_cur < sim_pt_cnt - 1 && sim_ms() >= p0->t)
+        rate = (p0[1].depth - p0->depth) * 60000.0 / (p0[1].t - p0->t);
+
+    if(ascent_fast && !dflt_warn_last)
+        dflt_warnings++;
+    dflt_warn_last = ascent_fast;
+
+    if(d <= 0 && !depth)
+        return;
+
+    if(fabs(depth * 0.1 - d) > dflt_err_max)
+        dflt_err_max = fabs(depth * 0.1 - d);
+    if(-depth_rate * 0.1 > dflt_asc_max)
+        dflt_asc_max = -depth_rate * 0.1;
+    if(-rate > prof_asc_max)
+        prof_asc_max = -rate;
+}
+
+// Zufallszahl 0..1, immer dieselbe Folge (Referenzwerte reproduzierbar)
+double sim_rand(void)
+{
+    sim_rand_state = sim_rand_state * 1103515245 + 12345;
+    return (sim_rand_state >> 16 & 0x7FFF) / 32768.0;
+}
+
+// Wandlung starten, das Ergebnis (Kennlinien umgekehrt zur Firmware:
+// Kanal 0 Tiefe in dm, 1 KTY 81-210, 2 Spannungsteiler) steht zu Beginn
+// fest, SIG_ADC kommt nach der Wandlungszeit
+void adc_start(char channel)
+{
+    double d, temp, v = 0;
+
+    sim_profile(&d, &temp);
+    switch(channel)
+    {
+      case 0: v = d * 10;
+        break;
+      case 1: v = temp * 2.9656 + 394.6344;
+        break;
+      case 2: v = accu_volt * 69;
+        break;
+    }
+    v += (sim_rand() + sim_rand() - 1) * ADC_NOISE;
+
+    if(v < 0)
+        v = 0;
+    if(v > 1023)
+        v = 1023;
+    adc_sample = (int) (v + 0.5);
+
+    adc_ready = sim_cyc + (adc_on ? ADC_CONV_CYC : ADC_FIRST_CYC);
+    adc_on = 1;
+    adc_conv = 1;
+    sim_next_event();
+}
+
+void adc_off(void)
+{
+    adc_on = 0;
+    adc_conv = 0;
+    sim_next_event();
+}
+
+// Bis zum naechsten Interrupt schlafen
+void adc_sleep(void)
+{
+    unsigned long long cyc = sim_next_ev > sim_cyc ? sim_next_ev - sim_cyc : 0;
+
+    sim_sleeping = 1;
+    sim_sleep_cyc += cyc;
+    sim_run(cyc);
+    sim_sleeping = 0;
+}
+
+int adc_read(void)
+{
+    return adc_sample;
+}
+
+// HD44780 auf Byteebene: Loeschen, Home, Entrymode, DDRAM-Adresse, Zeichen
+// Wartezeiten wie in der Firmware je nach LCD_TIMING (0 ms, 1 us, 2 Busy-
+// Flag). Bytes ohne Rechenzeit dazwischen zaehlen als ein Bild, die
+// Initialisierung (waitcycles > 1) nicht.
+void lcd_write(char lcdmode, unsigned char value, int waitcycles)
+{
+    unsigned long long start = sim_cyc;
+
+    if(lcd_timing == 0 || waitcycles > 1)
+        delay_ms(waitcycles * 2);
+    if(lcd_timing == 2 && waitcycles == 1)
+        sim_run(LCD_EXEC_CYC + LCD_WRITE_CYC);  // vorherigen Befehl abwarten
+    sim_run(LCD_WRITE_CYC);
+    if(lcd_timing == 1)
+        sim_run(LCD_DELAY_CYC);
+
+    if(waitcycles == 1)
+    {
+        if(start != lcd_last)
+        {
+            lcd_frames++;
+            lcd_frame_cyc = 0;
+        }
+        lcd_bytes++;
+        lcd_cyc += sim_cyc - start;
+        lcd_frame_cyc += sim_cyc - start;
+        if(lcd_frame_cyc > lcd_frame_max)
+            lcd_frame_max = lcd_frame_cyc;
+        lcd_last = sim_cyc;
+    }
+
+    if(lcdmode)
+    {
+        if(lcd_adr < 0x10)
+            lcd_ram[0][lcd_adr] = value;
+        else if(lcd_adr >= 0x40 && lcd_adr < 0x50)
+            lcd_ram[1][lcd_adr - 0x40] = value;
+        lcd_adr = (lcd_adr + (lcd_inc ? 1 : -1)) & 0x7F;
+    }
+    else if(value & 0x80)
+        lcd_adr = value & 0x7F;
+    else if(value == 1)
+    {
+        memset(lcd_ram, ' ', sizeof(lcd_ram));
+        lcd_adr = 0;
+        lcd_inc = 1;
+    }
+    else if((value & 0xFE) == 2)
+        lcd_adr = 0;
+    else if((value & 0xFC) == 4)
+        lcd_inc = (value & 2) != 0;
+}
+
+void led(char lednum, char status)
+{
+    if(lednum >= 2 && lednum < 5)
+        led_on[(int) lednum] = status;
+}
+
+int get_keys(void)
+{
+    unsigned long ms;
+    int t1;
+
+    // Die Firmware fragt die Tasten erst ab, wenn das Display fertig
+    // beschrieben ist
+    lcd_flush();
+    if(opt_lcd)
+        sim_show_lcd();
+
+    sim_run(KEYS_CYC);
+
+    ms = sim_ms();
+    for(t1 = 0; t1 < sim_key_cnt; t1++)
+        if(ms >= sim_keys[t1].t && ms < sim_keys[t1].t + sim_keys[t1].dur)
+            return sim_keys[t1].key;
+
+    return 0;
+}
+
+// Wie auf dem AVR ms - 1 Durchlaeufe zu 1 ms
+void delay_ms(int ms)
+{
+    if(ms > 1)
+        sim_run((ms - 1) * CYC_MS);
+}
+
+void usart_init(void)
+{
+    usart_on = 1;
+    usart_ubrr = USART_UBRR_INIT;
+}
+
+void usart_off(void)
+{
+    usart_on = 0;
+    tx_udrie = 0;
+}
+
+// UDR ist doppelt gepuffert: ist das Schieberegister frei, wandert das
+// Zeichen sofort hinein und UDR ist wieder leer, sonst erst, wenn das
+// vorherige Zeichen gesendet ist
+void usart_write(char tx_char)
+{
+    if(opt_usart)
+    {
+        sim_print_time(sim_ms());
+        printf(" TX %3u\n", (unsigned char) tx_char);
+    }
+    tx_cnt++;
+
+    if(tx_shift <= sim_cyc)
+    {
+        tx_udre = sim_cyc;
+        tx_shift = sim_cyc + USART_BYTE_CYC(usart_ubrr);
+    }
+    else
+    {
+        tx_udre = tx_shift;
+        tx_shift += USART_BYTE_CYC(usart_ubrr);
+    }
+    sim_next_event();
+}
+
+void usart_tx_on(void)
+{
+    tx_udrie = 1;
+    sim_next_event();
+}
+
+void usart_tx_off(void)
+{
+    tx_udrie = 0;
+    sim_next_event();
+}
+
+char usart_tx_done(void)
+{
+    return sim_cyc >= tx_shift;
+}
+
+void usart_baud(unsigned int ubrr)
+{
+    usart_ubrr = ubrr;
+}
+
+char usart_getc(void)
+{
+    return rx_byte;
+}
+
+// Wie in der avr-libc wird vor jedem Zugriff das Ende eines
+// laufenden Schreibvorgangs abgewartet
+void eeprom_wait(void)
+{
+    if(eeprom_busy > sim_cyc)
+        sim_run(eeprom_busy - sim_cyc);
+}
+
+// EE_RDY loest aus, sobald kein Schreibzugriff mehr laeuft. Anders als 
+// auf dem AVR auch waehrend power_save(), dort schlaeft die Firmware   
+// dann im Idle-Modus.                                                  
+void ee_rdy_on(void)
+{
+    ee_rdie = 1;
+    sim_next_event();
+}
+
+void ee_rdy_off(void)
+{
+    ee_rdie = 0;
+    sim_next_event();
+}
+
+// Den Stack des AVR gibt es hier nicht, gemeldet wird der Hoechstwert
+unsigned int stack_unused(void)
+{
+    return 0xFFFF;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *adr)
+{
+    eeprom_wait();
+    return eeprom_mem[(uintptr_t) adr % EEPROM_SIZE];
+}
+
+void eeprom_read_block(void *dst, const void *src, unsigned int n)
+{
+    uint8_t *p = (uint8_t*) dst;
+    const uint8_t *adr = (const uint8_t*) src;
+
+    while(n--)
+        *p++ = eeprom_read_byte(adr++);
+}
+
+void eeprom_write_byte(uint8_t *adr, uint8_t value)
+{
+    eeprom_wait();
+    eeprom_mem[(uintptr_t) adr % EEPROM_SIZE] = value;
+    eeprom_writes++;
+    eeprom_cell_writes[(uintptr_t) adr % EEPROM_SIZE]++;
+    eeprom_busy = sim_cyc + EEPROM_WRITE_CYC;
+    sim_next_event();
+}
+
+//***************************
+// Profildatei einlesen
+//***************************
+// Zeit in s oder [h:]mm:ss, Ergebnis in ms
+int sim_parse_time(char *s, unsigned long *ms)
+{
+    double t = 0, x;
+    char *end;
+
+    for(;;)
+    {
+        x = strtod(s, &end);
+        if(end == s || x < 0)
+            return 0;
+        t = t * 60 + x;
+        if(*end != ':')
+            break;
+        s = end + 1;
+    }
+
+    if(*end)
+        return 0;
+    *ms = (unsigned long) (t * 1000 + 0.5);
+    return 1;
+}
+
+int sim_load_profile(FILE *f)
+{
+    char line[512], *tok, *c;
+    int lineno = 0;
+    unsigned long t, t_rx;
+    unsigned long long c_rx;
+    double temp = 20, baud = USART_BAUD(USART_UBRR_INIT);
+
+    while(fgets(line, sizeof(line), f))
+    {
+        lineno++;
+        if((c = strchr(line, '#')))
+            *c = 0;
+        if(!(tok = strtok(line, " \t\r\n")))
+            continue;
+
+        if(!strcmp(tok, "T"))
+        {
+            struct sim_key *k = &sim_keys[sim_key_cnt];
+
+            if(sim_key_cnt >= SIM_MAX_KEYS || !(tok = strtok(NULL, " \t\r\n")) || !sim_parse_time(tok, &k->t)
+                || !(tok = strtok(NULL, " \t\r\n")) || (k->key = atoi(tok)) < 1 || k->key > 3)
+                goto error;
+            k->dur = 500;
+            if((tok = strtok(NULL, " \t\r\n")))
+                k->dur = (unsigned long) (atof(tok) * 1000);
+            t = k->t + k->dur;
+            sim_key_cnt++;
+        }
+        else if(!strcmp(tok, "U"))
+        {
+            if(!(tok = strtok(NULL, " \t\r\n")) || !sim_parse_time(tok, &t_rx))
+                goto error;
+            c_rx = t_rx * CYC_MS;
+            if(sim_rx_cnt && c_rx < sim_rxq[sim_rx_cnt - 1].t)
+                goto error;
+            while((tok = strtok(NULL, " \t\r\n")))
+            {
+                if(sim_rx_cnt >= SIM_MAX_RX)
+                    goto error;
+                sim_rxq[sim_rx_cnt].t = c_rx;
+                sim_rxq[sim_rx_cnt].baud = baud;
+                sim_rxq[sim_rx_cnt++].byte = (unsigned char) strtol(tok, NULL, 0);
+                c_rx += CPU_HZ * 10 / baud;
+            }
+            t = c_rx / CYC_MS;
+        }
+        else if(!strcmp(tok, "B"))
+        {
+            if(!(tok = strtok(NULL, " \t\r\n")) || (baud = atof(tok)) < 300)
+                goto error;
+            continue;
+        }
+        else
+        {
+            struct sim_point *p = &sim_pt[sim_pt_cnt];
+
+            if(sim_pt_cnt >= SIM_MAX_POINTS || !sim_parse_time(tok, &p->t)
+                || (sim_pt_cnt && p->t < sim_pt[sim_pt_cnt - 1].t) || !(tok = strtok(NULL, " \t\r\n")))
+                goto error;
+            p->depth = atof(tok);
+            if((tok = strtok(NULL, " \t\r\n")))
+                temp = atof(tok);
+            p->temp = temp;
+            t = p->t;
+            sim_pt_cnt++;
+        }
+
+        if(t > sim_end_ms)
+            sim_end_ms = t;
+    }
+
+    if(!sim_pt_cnt)
+    {
+        fprintf(stderr, "Profil enthaelt keine Stuetzpunkte\n");
+        return 0;
+    }
+    return 1;
+
+error:
+    fprintf(stderr, "Fehler in Zeile %d der Profildatei\n", lineno);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f;
+    int t1;
+
+    for(t1 = 1; t1 < argc - 1; t1++)
+    {
+        if(!strcmp(argv[t1], "-l"))
+            opt_lcd = 1;
+        else if(!strcmp(argv[t1], "-s"))
+            opt_usart = 1;
+        else if(!strcmp(argv[t1], "-b"))
+            opt_bench = 1;
+        else if(!strcmp(argv[t1], "-c") && t1 < argc - 2)
+            bench_cmp_file = argv[++t1];
+        else if(!strcmp(argv[t1], "-w") && t1 < argc - 2)
+            bench_ref_file = argv[++t1];
+        else if(!strcmp(argv[t1], "-e") && t1 < argc - 2)
+            eeprom_file = argv[++t1];
+        else if(!strcmp(argv[t1], "-u") && t1 < argc - 2)
+            accu_volt = atof(argv[++t1]);
+        else
+            break;
+    }
+
+    if(t1 != argc - 1)
+    {
+        fprintf(stderr, "Aufruf: %s [-l] [-s] [-b] [-c datei] [-w datei] [-e eeprom.bin] [-u Volt] profil.txt\n", argv[0]);
+        return 1;
+    }
+
+    if(!strcmp(argv[t1], "-"))
+        f = stdin;
+    else if(!(f = fopen(argv[t1], "r")))
+    {
+        perror(argv[t1]);
+        return 1;
+    }
+    if(!sim_load_profile(f))
+        return 1;
+    if(f != stdin)
+        fclose(f);
+
+    // EEPROM wie nach "Flashspeicher loeschen" (clear_flash(2)): alles 0,
+    // Profilzeiger an Adresse 30/31 auf EEPROM_PROF_START, oder Abbild
+    // eines frueheren Laufs
+    memset(eeprom_mem, 0, EEPROM_SIZE);
+    eeprom_mem[30] = 50;
+    if(eeprom_file && (f = fopen(eeprom_file, "rb")))
+    {
+        if(fread(eeprom_mem, 1, EEPROM_SIZE, f) != EEPROM_SIZE)
+            fprintf(stderr, "%s: EEPROM-Abbild unvollstaendig\n", eeprom_file);
+        fclose(f);
+    }
+
+    memset(lcd_ram, ' ', sizeof(lcd_ram));
+    memset(lcd_shown, ' ', sizeof(lcd_shown));
+
+    // Zaehler aus der Initialisierung globaler Variablen verwerfen
+    memset(fop_cnt, 0, sizeof(fop_cnt));
+    sim_cyc = 0;
+    sim_end = sim_end_ms * CYC_MS;
+    sim_next_event();
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    sbtc_main();
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+//***************************************************************//
+//  Simulation des SBTC3b auf dem PC                              //
+//  ************************************************************ //
+//  Ersatz fuer die AVR-Header beim Uebersetzen mit HOST_SIM.    //
+//  Die Nachbildung der Hardware steht in host_sim.c.            //
+//***************************************************************//
+
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+
+// main() der Firmware wird von der Simulation aufgerufen
+#ifndef HOST_SIM_IMPL
+#define main sbtc_main
+#endif
+int sbtc_main(void);
+
+// Interruptroutinen werden zu normalen Funktionen, die die Simulation
+// zum passenden Zeitpunkt aufruft
+#define SIGNAL(vect) void vect(void)
+#define ISR(vect) void vect(void)
+#define SIG_OVERFLOW2 sim_isr_timer2
+#define SIG_ADC sim_isr_adc
+#define SIG_UART_RECV sim_isr_uart_recv
+#define SIG_UART_DATA sim_isr_uart_data
+#define SIG_EEPROM_READY sim_isr_ee_rdy
+
+void sim_isr_timer2(void);
+void sim_isr_adc(void);
+void sim_isr_uart_recv(void);
+void sim_isr_uart_data(void);
+void sim_isr_ee_rdy(void);
+
+// Interrupts werden nur zwischen zwei Befehlen ausgeloest,
+// sperren ist daher unnoetig
+#define sei()
+#define cli()
+
+// EEPROM (1 kByte), siehe <avr/eeprom.h>
+uint8_t eeprom_read_byte(const uint8_t*);
+void eeprom_read_block(void*, const void*, unsigned int);
+void eeprom_write_byte(uint8_t*, uint8_t);
+#define eeprom_is_ready() 1
+
+// Programmspeicher, siehe <avr/pgmspace.h>. Auf dem PC liegen die
+// Tabellen im normalen Speicher, pgm_read_*() liefern den Typ der
+// Tabelle (int hat hier 32 Bit, float mit SIM_BENCH ist sim_float).
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(p))
+#define pgm_read_word(p) (*(p))
+#define pgm_read_dword(p) (*(p))
+#define pgm_read_float(p) (*(p))
+
+// Abschnitte der Hauptschleife fuer die Laufzeitmessung. BENCH_SECTION(s)
+// ordnet alle folgenden Taktzyklen bis zum naechsten Aufruf dem
+// Abschnitt s zu, power_save() beendet einen Schleifendurchlauf.
+enum
+{
+    BENCH_LOOP,       // Ablaufsteuerung, Moduswechsel
+    BENCH_DSENSOR,    // get_dsensor() mit Tiefenanzeige
+    BENCH_PPO2,       // calc_ppo2()
+    BENCH_DISPLAY,    // Wechselanzeige an der Oberflaeche
+    BENCH_TSENSOR,    // get_tsensor() und Displayloeschen alle 10 s
+    BENCH_INERT_GAS,  // calc_p_inert_gas()
+    BENCH_DECO,       // calc_deco()
+    BENCH_CNS_OTU,    // calc_cns_otu()
+    BENCH_LOG,        // EEPROM: Profilpunkte, Beginn und Ende des TG
+    BENCH_LCD,        // lcd_flush(): geaenderte Zeichen zum Display
+    BENCH_KEYS,       // Tastenabfrage und Menues (nicht im Zeitbudget)
+    BENCH_SECTIONS
+};
+void sim_bench_section(int);
+#define BENCH_SECTION(s) sim_bench_section(s)
+
+// Gleitkommaoperationen, Kosten siehe fop_cycles in host_sim.c
+enum
+{
+    FOP_ADD,   // Addition und Subtraktion
+    FOP_MUL,
+    FOP_DIV,
+    FOP_CMP,
+    FOP_CONV,  // Umwandlung int <-> float
+    FOP_EXP,
+    FOP_LOG,
+    FOP_POW,
+    FOP_SQRT,
+    FOP_MISC,  // fabs, floor, ceil
+    FOPS
+};
+void sim_fop(int);
+
+// Laufzeitmessung: Firmware als C++ mit zaehlendem float uebersetzen
+#if defined(SIM_BENCH) && !defined(HOST_SIM_IMPL)
+#include "sim_float.h"
+#endif
+
+#endif
@@ -0,0 +1,232 @@
+//***************************************************************//
+//  Logbuch des SBTC3b auf dem PC auswerten                       //
+//  ************************************************************ //
+//  Liest ein EEPROM-Abbild (1024 Bytes, z.B. per Blockuebertra-  //
+//  gung geladen oder von host_sim -e geschrieben) und gibt die   //
+//  TG des Verzeichnisses mit dekodiertem Profil aus.             //
+//***************************************************************//
+//
+// Uebersetzen (aus dem Hauptverzeichnis):
+//
+//   gcc -O2 -o sbtc_log host/sbtc_log.c
+//
+// Aufruf:
+//
+//   ./sbtc_log [-p] eeprom.bin
+//
+//   -p  Profil ausgeben (Zeit [s], Tiefe [m] und Ereignisse)
+//
+// Aufbau von Verzeichnis, Ringspeicher und Profilformat siehe
+// open_source_dive_computer.c (DIR_*, EEPROM_PROF_*, PROF_FMT_*, LOG_*),
+// die Konstanten hier muessen dazu passen.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EEPROM_SIZE 1024
+#define EEPROM_PROF_START 50
+#define DIR_ENTRIES 12
+#define DIR_ENTRY_SIZE 6
+#define DIR_START (EEPROM_SIZE - DIR_ENTRIES * DIR_ENTRY_SIZE)
+#define DIR_MAGIC_ADR 32
+#define DIR_MAGIC 0xD1
+#define EEPROM_PROF_END (DIR_START - 1)
+#define EEPROM_PROF_SIZE (EEPROM_PROF_END - EEPROM_PROF_START + 1)
+#define PROF_FMT_DELTA 0x80
+#define PROF_FMT_TOTALS 0x40
+#define PROF_FMT_MASK 0x3F
+#define DIR_LOG_LEN 32
+#define LOG_NUM_HI 26
+#define LOG_MINUTES 27
+#define LOG_MAXDEPTH 29
+#define PROF_SINGLE 147
+#define PROF_PAIR 170
+#define PROF_ABS 234
+#define PROF_RUN 233
+
+unsigned char ee[EEPROM_SIZE];
+
+unsigned int prof_adr(unsigned int adr)
+{
+    while(adr > EEPROM_PROF_END)
+        adr -= EEPROM_PROF_SIZE;
+
+    return adr;
+}
+
+unsigned int prof_dist(unsigned int from, unsigned int to)
+{
+    return to >= from ? to - from : to + EEPROM_PROF_SIZE - from;
+}
+
+unsigned int ee_word(unsigned int adr)
+{
+    return ee[adr] + 256 * ee[adr + 1];
+}
+
+// Byte im Ringspeicher relativ zu einer Startadresse
+unsigned char prof_byte(unsigned int base, unsigned int off)
+{
+    return ee[prof_adr(base + off)];
+}
+
+void print_sample(unsigned int sample, int interval, int depth)
+{
+    printf("  %6u  %5.1f\n", sample * interval, depth * 0.1);
+}
+
+void print_event(unsigned int sample, int interval, const char *text)
+{
+    printf("  %6u         %s\n", sample * interval, text);
+}
+
+// Profil zwischen 229 (start) und 230 (end) dekodieren
+void print_profile(unsigned int start, unsigned int end, unsigned char fmt)
+{
+    unsigned int t1, sample = 0, len = prof_dist(start, end);
+    int interval = fmt & PROF_FMT_MASK, depth = 0, n;
+    unsigned char b;
+    char text[32];
+
+    for(t1 = 1; t1 < len; t1++)
+    {
+        b = prof_byte(start, t1);
+
+        switch(b)
+        {
+          case 223: print_event(sample, interval, "Dekostufe unterschritten"); continue;
+          case 224: print_event(sample, interval, "ppO2 ueberschritten"); continue;
+          case 225: print_event(sample, interval, "Nullzeit abgelaufen"); continue;
+          case 227: print_event(sample, interval, "aufgetaucht"); continue;
+          case 226:
+            sprintf(text, "Wechsel zu Gas %d", prof_byte(start, ++t1) + 1);
+            print_event(sample, interval, text);
+            continue;
+        }
+
+        if(!(fmt & PROF_FMT_DELTA))
+        {
+            if(b < 99)
+                print_sample(++sample, interval, b * 10);
+        }
+        else if(b < PROF_SINGLE - 22)
+        {
+            depth += b / 25 - 2;
+            print_sample(++sample, interval, depth);
+            depth += b / 5 % 5 - 2;
+            print_sample(++sample, interval, depth);
+            depth += b % 5 - 2;
+            print_sample(++sample, interval, depth);
+        }
+        else if(b < PROF_PAIR)
+        {
+            depth += b - PROF_SINGLE;
+            print_sample(++sample, interval, depth);
+        }
+        else if(b < PROF_PAIR + 49)
+        {
+            depth += (b - PROF_PAIR) / 7 - 3;
+            print_sample(++sample, interval, depth);
+            depth += (b - PROF_PAIR) % 7 - 3;
+            print_sample(++sample, interval, depth);
+        }
+        else if(b == PROF_ABS)
+        {
+            depth = prof_byte(start, t1 + 1) * 200 + prof_byte(start, t1 + 2);
+            t1 += 2;
+            print_sample(++sample, interval, depth);
+        }
+        else if(b > PROF_ABS)
+        {
+            for(n = b - PROF_RUN; n; n--)
+                print_sample(++sample, interval, depth);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int slot = 0, t1, n, start, end, dive_nr = 0xFFFF, found;
+    int opt_profile = 0;
+    FILE *f;
+
+    if(argc > 1 && !strcmp(argv[1], "-p"))
+    {
+        opt_profile = 1;
+        argc--;
+        argv++;
+    }
+
+    if(argc != 2)
+    {
+        fprintf(stderr, "Aufruf: %s [-p] eeprom.bin\n", argv[0]);
+        return 1;
+    }
+
+    if(!(f = fopen(argv[1], "rb")) || fread(ee, 1, EEPROM_SIZE, f) != EEPROM_SIZE)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    if(ee[DIR_MAGIC_ADR] != DIR_MAGIC)
+    {
+        fprintf(stderr, "%s: kein TG-Verzeichnis\n", argv[1]);
+        return 1;
+    }
+
+    // Gesamtwerte stehen im Datensatz des neuesten TG, bei aelteren
+    // Formaten in den Zellen 24 bis 29
+    for(t1 = found = 0; t1 < DIR_ENTRIES; t1++)
+    {
+        n = ee_word(DIR_START + t1 * DIR_ENTRY_SIZE + 4);
+        if(n > found)
+        {
+            found = n;
+            slot = t1;
+        }
+    }
+    start = ee_word(DIR_START + slot * DIR_ENTRY_SIZE);
+    end = ee_word(DIR_START + slot * DIR_ENTRY_SIZE + 2);
+
+    if(found && (prof_byte(start, 4) & PROF_FMT_TOTALS))
+        printf("Anzahl TG: %u, Gesamttauchzeit: %u min, Max. Tiefe: %.1f m\n", found,
+            prof_byte(end, LOG_MINUTES) + 256 * prof_byte(end, LOG_MINUTES + 1),
+            (prof_byte(end, LOG_MAXDEPTH) + 256 * prof_byte(end, LOG_MAXDEPTH + 1)) * 0.1);
+    else
+        printf("Anzahl TG: %u, Gesamttauchzeit: %u min, Max. Tiefe: %.1f m\n",
+            ee_word(24), ee_word(26), ee_word(28) * 0.1);
+
+    // Vom neuesten zum aeltesten TG
+    for(;;)
+    {
+        found = 0;
+        for(t1 = 0; t1 < DIR_ENTRIES; t1++)
+        {
+            n = ee_word(DIR_START + t1 * DIR_ENTRY_SIZE + 4);
+            if(n && n < dive_nr && n > found)
+            {
+                found = n;
+                slot = t1;
+            }
+        }
+        if(!found)
+            break;
+
+        dive_nr = found;
+        start = ee_word(DIR_START + slot * DIR_ENTRY_SIZE);
+        end = ee_word(DIR_START + slot * DIR_ENTRY_SIZE + 2);
+
+        printf("\nTG %u: OFP vorher %u min, %u min, max. %.1f m, min. %d C\n", dive_nr,
+            prof_byte(start, 1) + 256 * prof_byte(start, 2),
+            prof_byte(end, 1) + 256 * prof_byte(end, 2),
+            (prof_byte(end, 3) + 256 * prof_byte(end, 4)) * 0.1, (signed char) prof_byte(end, 5));
+
+        if(opt_profile)
+            print_profile(prof_adr(start + 5), end, prof_byte(start, 4));
+    }
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+//***************************************************************//
+//  Simulation des SBTC3b auf dem PC                              //
+//  ************************************************************ //
+//  Zaehlender Gleitkommatyp fuer die Laufzeitmessung (SIM_BENCH) //
+//***************************************************************//
+//
+// Die Firmware wird fuer die Laufzeitmessung als C++ uebersetzt, float
+// und double werden durch sim_float ersetzt. Wie beim AVR (double =
+// float) wird mit 32 Bit gerechnet, jede Operation meldet sich ueber
+// sim_fop() bei der Simulation, die dafuer die Taktzyklen der Soft-
+// Float-Routinen der avr-libc ansetzt.
+//
+// Nicht erfasst werden Ausdruecke, die nur aus int-Werten und
+// Gleitkommakonstanten bestehen (z.B. adc_result[2] * 0.25), da sie in C++
+// nicht ueberladen werden koennen. Konstante Argumente (log(2)) faltet
+// avr-gcc beim Uebersetzen, sie werden daher wie dort nicht gezaehlt.
+
+#ifndef SIM_FLOAT_H
+#define SIM_FLOAT_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_INLINE inline __attribute__((always_inline))
+
+// Ganzzahlige Operanden, deren Umwandlung nach float Zeit kostet
+#define SIM_INT_TYPES(F) F(char) F(signed char) F(unsigned char) F(short) F(unsigned short) \
+    F(int) F(unsigned int) F(long) F(unsigned long)
+
+class sim_float
+{
+  public:
+    float v;
+
+    SIM_INLINE sim_float() {}
+    SIM_INLINE sim_float(double x) : v(x) {}
+    SIM_INLINE sim_float(float x) : v(x) {}
+#define SIM_FROM_INT(T) SIM_INLINE sim_float(T x) : v(x) { if(!__builtin_constant_p(x)) sim_fop(FOP_CONV); }
+    SIM_INT_TYPES(SIM_FROM_INT)
+#undef SIM_FROM_INT
+
+    // Umwandlung nach int, char usw. und Wahrheitswert
+    SIM_INLINE operator double() const { sim_fop(FOP_CONV); return v; }
+
+    SIM_INLINE sim_float operator-() const { sim_float r; r.v = -v; return r; }
+    SIM_INLINE sim_float operator+() const { return *this; }
+
+    SIM_INLINE sim_float &operator+=(sim_float b) { sim_fop(FOP_ADD); v += b.v; return *this; }
+    SIM_INLINE sim_float &operator-=(sim_float b) { sim_fop(FOP_ADD); v -= b.v; return *this; }
+    SIM_INLINE sim_float &operator*=(sim_float b) { sim_fop(FOP_MUL); v *= b.v; return *this; }
+    SIM_INLINE sim_float &operator/=(sim_float b) { sim_fop(FOP_DIV); v /= b.v; return *this; }
+    SIM_INLINE sim_float &operator++() { sim_fop(FOP_ADD); v += 1; return *this; }
+    SIM_INLINE sim_float &operator--() { sim_fop(FOP_ADD); v -= 1; return *this; }
+    SIM_INLINE sim_float operator++(int) { sim_float r = *this; ++*this; return r; }
+    SIM_INLINE sim_float operator--(int) { sim_float r = *this; --*this; return r; }
+};
+
+// Rechenoperationen, gemischt mit double- oder int-Operanden
+#define SIM_OP(op, fop) \
+    SIM_INLINE sim_float operator op(sim_float a, sim_float b) { sim_float r; sim_fop(fop); r.v = a.v op b.v; return r; } \
+    SIM_INLINE sim_float operator op(sim_float a, double b) { return a op sim_float(b); } \
+    SIM_INLINE sim_float operator op(double a, sim_float b) { return sim_float(a) op b; }
+#define SIM_OP_INT(T) \
+    SIM_INLINE sim_float operator+(sim_float a, T b) { return a + sim_float(b); } \
+    SIM_INLINE sim_float operator+(T a, sim_float b) { return sim_float(a) + b; } \
+    SIM_INLINE sim_float operator-(sim_float a, T b) { return a - sim_float(b); } \
+    SIM_INLINE sim_float operator-(T a, sim_float b) { return sim_float(a) - b; } \
+    SIM_INLINE sim_float operator*(sim_float a, T b) { return a * sim_float(b); } \
+    SIM_INLINE sim_float operator*(T a, sim_float b) { return sim_float(a) * b; } \
+    SIM_INLINE sim_float operator/(sim_float a, T b) { return a / sim_float(b); } \
+    SIM_INLINE sim_float operator/(T a, sim_float b) { return sim_float(a) / b; }
+
+SIM_OP(+, FOP_ADD)
+SIM_OP(-, FOP_ADD)
+SIM_OP(*, FOP_MUL)
+SIM_OP(/, FOP_DIV)
+SIM_INT_TYPES(SIM_OP_INT)
+
+// Vergleiche
+#define SIM_CMP(op) \
+    SIM_INLINE bool operator op(sim_float a, sim_float b) { sim_fop(FOP_CMP); return a.v op b.v; } \
+    SIM_INLINE bool operator op(sim_float a, double b) { return a op sim_float(b); } \
+    SIM_INLINE bool operator op(double a, sim_float b) { return sim_float(a) op b; }
+#define SIM_CMP_INT(T) \
+    SIM_INLINE bool operator<(sim_float a, T b) { return a < sim_float(b); } \
+    SIM_INLINE bool operator<(T a, sim_float b) { return sim_float(a) < b; } \
+    SIM_INLINE bool operator>(sim_float a, T b) { return a > sim_float(b); } \
+    SIM_INLINE bool operator>(T a, sim_float b) { return sim_float(a) > b; } \
+    SIM_INLINE bool operator<=(sim_float a, T b) { return a <= sim_float(b); } \
+    SIM_INLINE bool operator<=(T a, sim_float b) { return sim_float(a) <= b; } \
+    SIM_INLINE bool operator>=(sim_float a, T b) { return a >= sim_float(b); } \
+    SIM_INLINE bool operator>=(T a, sim_float b) { return sim_float(a) >= b; } \
+    SIM_INLINE bool operator==(sim_float a, T b) { return a == sim_float(b); } \
+    SIM_INLINE bool operator==(T a, sim_float b) { return sim_float(a) == b; } \
+    SIM_INLINE bool operator!=(sim_float a, T b) { return a != sim_float(b); } \
+    SIM_INLINE bool operator!=(T a, sim_float b) { return sim_float(a) != b; }
+
+SIM_CMP(<)
+SIM_CMP(>)
+SIM_CMP(<=)
+SIM_CMP(>=)
+SIM_CMP(==)
+SIM_CMP(!=)
+SIM_INT_TYPES(SIM_CMP_INT)
+
+// Mathematische Funktionen der avr-libc
+#define SIM_FN(fn, fop) \
+    SIM_INLINE sim_float fn(sim_float x) { sim_float r; sim_fop(fop); r.v = fn##f(x.v); return r; }
+#define SIM_FN_INT(T) \
+    SIM_INLINE sim_float exp(T x) { return __builtin_constant_p(x) ? sim_float(::exp((double) x)) : exp(sim_float(x)); } \
+    SIM_INLINE sim_float log(T x) { return __builtin_constant_p(x) ? sim_float(::log((double) x)) : log(sim_float(x)); }
+
+SIM_FN(exp, FOP_EXP)
+SIM_FN(log, FOP_LOG)
+SIM_FN(sqrt, FOP_SQRT)
+SIM_FN(fabs, FOP_MISC)
+SIM_FN(floor, FOP_MISC)
+SIM_FN(ceil, FOP_MISC)
+SIM_INT_TYPES(SIM_FN_INT)
+
+SIM_INLINE sim_float pow(sim_float x, sim_float y) { sim_float r; sim_fop(FOP_POW); r.v = powf(x.v, y.v); return r; }
+
+#define float sim_float
+#define double sim_float
+
+#endif
@@ -32,8 +32,10 @@
 // 21    Display Léitung 14
 // 22    Display Léitung 6
 // 23    Display Léitung 4
+// 27    Display Leitung 5 (R/W, nur mit LCD_TIMING_BUSY, sonst R/W an GND)
 // 24    LED 1 (Rechnung aktiv)
 // 25    LED 2 (Dekostufe übertaucht!)
+// 26    LED 3 (Aufstieg zu schnell)
 // 28    X-TAL
 // 29    X-TAL
 // 30    Vcc ADC
@@ -45,21 +47,29 @@
 //          1bar <= p <= 9 bar; 0V <= U <= 2.56 V
 
 #include <stdio.h>
+#ifdef HOST_SIM
+#include "host_sim.h"   // Simulation auf dem PC, siehe host/host_sim.c 
+#else
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <util/delay.h>
-#include <math.h>
 #include <avr/wdt.h>
 #include <avr/sleep.h>
 #include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#endif
+#include <math.h>
 #include <string.h>
 
 
 //*****************
 //  Benutzermenue  
 //*****************
+// Texte und Tabellen, die sich nicht aendern, stehen mit PROGMEM nur im 
+// Flash (sonst kopiert der Startcode sie ins SRAM), gelesen wird mit     
+// pgm_read_*() bzw. lcd_putstring_P().                                   
 #define MENU_ITEMS 7
-char menu_str[MENU_ITEMS][18]={"Luftdruck NN",
+const char menu_str[MENU_ITEMS][18] PROGMEM = {"Luftdruck NN",
                                 "Hoehe ueber NN",
                                 "Kabinendruck",
                                 "Max. ppO2",
@@ -67,7 +77,7 @@ char menu_str[MENU_ITEMS][18]={"Luftdruck NN",
                         "ppN2 anzeigen",
                         "Einstellungen"};
 
-char menu_unitstr[MENU_ITEMS][6]={"mbar",
+const char menu_unitstr[MENU_ITEMS][6] PROGMEM = {"mbar",
                                    "m",
                                    "mbar",
                                    "bar",
@@ -75,31 +85,199 @@ char menu_unitstr[MENU_ITEMS][6]={"mbar",
                            "",
                            ""};
 
-int menu_digits[MENU_ITEMS] = {-1, -1, -1, 2, 2,  -1, -1}; // Zahl der Ziffern 
-int menu_dec[MENU_ITEMS] = {-1, -1, -1, 1, 1, -1, -1};     // Position des Dezimalpunktes 
+const signed char menu_digits[MENU_ITEMS] PROGMEM = {-1, -1, -1, 2, 2,  -1, -1}; // Zahl der Ziffern 
+const signed char menu_dec[MENU_ITEMS] PROGMEM = {-1, -1, -1, 1, 1, -1, -1};     // Position des Dezimalpunktes 
 
 int show_settings = 0;
 
 //*****************
 // EEPROM-Speicher 
 //*****************
-#include <avr/eeprom.h>
 #define MAX_EEPROM_ADR 1023
 #define EEPROM_PROF_START 50
 
+// Verzeichnis der TG am Ende des EEPROMs, davor der Ringspeicher der Profile. 
+// Je Eintrag: Start (Adresse von 228), Ende (Adresse von 230), Nr. des TG,  
+// jeweils Lo/Hi. Nr. 0 = Eintrag leer.                                       
+#define DIR_ENTRIES 12
+#define DIR_ENTRY_SIZE 6
+#define DIR_START (MAX_EEPROM_ADR + 1 - DIR_ENTRIES * DIR_ENTRY_SIZE)
+#define DIR_POS_START 0
+#define DIR_POS_END 1
+#define DIR_NUM 2
+#define DIR_MAGIC_ADR 32     // Kennung: Verzeichnis gueltig 
+#define DIR_MAGIC 0xD1
+#define DIR_LOG_LEN 32       // Datensatz ab Profilende (230 bis 233) 
+#define DIR_LOG_LEN_OLD 27   // dto. ohne PROF_FMT_TOTALS 
+#define LOG_LEN(fmt) ((fmt) & PROF_FMT_TOTALS ? DIR_LOG_LEN : DIR_LOG_LEN_OLD)
+
+// Der Datensatz jedes TG (mit PROF_FMT_TOTALS) endet mit den Gesamtwerten 
+// des Logbuchs. Der des neuesten TG ersetzt die Zaehler bei 24..29 und   
+// den Profilzeiger bei 30/31, die sonst bei jedem TG an derselben Stelle 
+// ueberschrieben wuerden. Dort stehen nur noch die Werte von aelterer    
+// Firmware bzw. nach dem Loeschen der Profile (log_init()).              
+#define LOG_NUM_HI 26        // HiByte der Nr. des TG (LoByte bei 19) 
+#define LOG_MINUTES 27       // Gesamttauchzeit [min] Lo/Hi 
+#define LOG_MAXDEPTH 29      // Max. Tiefe aller TG [dm] Lo/Hi 
+
+#define EEPROM_PROF_END (DIR_START - 1)
+#define EEPROM_PROF_SIZE (EEPROM_PROF_END - EEPROM_PROF_START + 1)
+
+// Schreibpuffer (Ring) fuer das EEPROM. ee_put() stellt ein Byte ein, 
+// SIG_EEPROM_READY schreibt es im Hintergrund (ca. 8.5 ms je Byte),   
+// ohne die Hauptschleife anzuhalten oder Interrupts zu sperren.      
+// ee_read() liefert noch nicht geschriebene Bytes aus dem Puffer,    
+// ee_flush() wartet, bis alle Bytes im EEPROM stehen.                
+#define EE_QUEUE_SIZE 64  // Zweierpotenz, reicht fuer das Ende eines TG 
+#define EE_QUEUE_MASK (EE_QUEUE_SIZE - 1)
+
+unsigned int ee_queue_adr[EE_QUEUE_SIZE];
+unsigned char ee_queue_val[EE_QUEUE_SIZE];
+volatile unsigned char ee_head = 0, ee_tail = 0;  // einstellen / schreiben 
+unsigned char ee_queue_max = 0;  // Hoechststand des Puffers 
+
+void ee_put(unsigned int, unsigned char);
+unsigned char ee_read(unsigned int);
+void ee_flush(void);
+
+// TG im Ringspeicher: 228, Kopf (OFP Lo/Hi, Temperatur, Intervall), 229,    
+// Profil, 230, Datensatz bis 233. Profil mit PROF_FMT_DELTA im Intervallbyte:
+// Tiefe in [dm] als Differenz zum vorherigen Messpunkt (alle 20 s, ab 0):    
+//   0..124    drei Messpunkte, a, b, c je -2..2: (a + 2) * 25 + (b + 2) * 5 + c + 2
+//   125..169  ein Messpunkt, d = -22..22: d + 147                             
+//   170..218  zwei Messpunkte, a, b je -3..3: 170 + (a + 3) * 7 + b + 3        
+//   223..227  Ereignisse wie bisher, 226 gefolgt von der Nr. des Gases        
+//   234 H L   ein Messpunkt, absolute Tiefe H * 200 + L (H, L < 200)          
+//   236..255  3..22 Messpunkte ohne Aenderung: 233 + Anzahl                   
+// Die Bytes 219..233 kommen in den Messpunkten nie vor, 235 ist unbenutzt.  
+// Aeltere Profile (Intervallbyte = 20): 1 Byte pro Messpunkt in [m].         
+#define PROF_FMT_DELTA 0x80
+#define PROF_FMT_TOTALS 0x40  // Datensatz mit Gesamtwerten (LOG_*) 
+#define PROF_FMT_MASK 0x3F    // Intervall 
+#define PROF_INTERVAL 20   // [s] 
+#define PROF_TRIPLE 0
+#define PROF_SINGLE 147
+#define PROF_PAIR 170
+#define PROF_ABS 234
+#define PROF_RUN 233
+#define PROF_RUN_MAX 22
+
 void eeprom_store_byte(char);
 void clear_flash(char);
 void display_profile(void);
 void display_rcd(void);
 void display_log(void);
+unsigned int prof_adr(unsigned int);
+unsigned int prof_dist(unsigned int, unsigned int);
+unsigned int dir_read(int, int);
+void dir_write(int, int, unsigned int);
+int dir_find(unsigned int);
+int dir_slot(unsigned int, unsigned int);
+void dir_set(int, unsigned int, unsigned int, unsigned int);
+void dir_rebuild(void);
+void log_init(void);
+void prof_store_depth(int);
+void prof_store_marker(unsigned char);
+void prof_flush(void);
+void prof_flush_zero(void);
+void prof_put(int);
+char prof_show(unsigned int, int);
 int eeprom_byte_count;                 // Positionszeiger fuer EEPROM 
+unsigned int dive_start_adr, dive_log_adr;  // Lage des laufenden TG im Ringspeicher 
+unsigned int log_dives, log_minutes, log_maxdepth;  // Gesamtwerte des Logbuchs 
+int prof_depth;                        // zuletzt gespeicherte Tiefe [dm] 
+unsigned char prof_zero;               // zurueckgehaltene Messpunkte ohne Aenderung 
+char prof_buf[2];                      // zurueckgehaltene kleine Differenzen 
+unsigned char prof_buf_cnt;
 
 //*******************
 // Timer & Interrupt 
 //*******************
 //#define F_CPU 8000000      // Taktfrequenz im MHz in <util/delay.h>                               
 #define INITWAIT 750         // Wartezeit fuer Anzeigewechsel bei Programmstart   
+#define TICKS_PER_S 4        // Timer-2-Ueberlaeufe pro Sekunde (Teiler ck/32)    
 unsigned long runseconds = 0, diveseconds = 0, surf_seconds = 0;
+unsigned char ticks = 0;             // Timerueberlaeufe in der laufenden Sekunde    
+
+//*******************
+// Aufgabenplaner    
+//*******************
+// Die periodischen Aufgaben der Hauptschleife stehen in task_fn[]. 
+// sched_run() ruft jede Aufgabe, deren Termin task_due (runseconds) 
+// erreicht ist, in der Reihenfolge der Tabelle auf und setzt den    
+// naechsten Termin task_period Sekunden spaeter. Danach schlaeft    
+// power_save() bis zum fruehesten Termin (sched_next()).           
+// Je Aufgabe werden Aufrufe, verpasste Termine (mind. eine Sekunde 
+// zu spaet begonnen) und die laengste Laufzeit gezaehlt.          
+#define TASK_SENSORS 0       // Tiefe, ppO2 
+#define TASK_DIVE 1          // TG-Beginn und -Ende, Logbuch 
+#define TASK_DISPLAY 2       // Wechselanzeige an der Oberflaeche 
+#define TASK_TISSUE 3        // Temperatur, Saettigung, Beginn der Dekorechnung 
+#define TASK_DECO 4          // Dekorechnung in Zeitscheiben 
+#define TASK_PROFILE 5       // Profilpunkt 
+#define TASK_KEYS 6          // Display, Tasten und Menues 
+#define TASKS 7
+
+void task_sensors(void);
+void task_dive(void);
+void task_display(void);
+void task_tissue(void);
+void task_deco(void);
+void task_profile(void);
+void task_keys(void);
+
+void (*task_fn[TASKS])(void) = {task_sensors, task_dive, task_display, task_tissue,
+    task_deco, task_profile, task_keys};
+unsigned char task_period[TASKS] = {1, 1, 3, 10, 1, PROF_INTERVAL, 1};  // [s] 
+unsigned long task_due[TASKS];       // naechster Termin [runseconds]           
+unsigned int task_runs[TASKS];       // Aufrufe                                 
+unsigned int task_missed[TASKS];     // verpasste Termine                       
+unsigned int task_time_max[TASKS];   // laengste Laufzeit [1/1024 s]            
+
+void sched_init(void);
+void sched_run(void);
+unsigned long sched_next(void);
+unsigned long sched_clock(void);
+
+//*************************
+// Hardwarezugriff (HAL)   
+//*************************
+// Alle Zugriffe auf die Register des ATmega32 stecken in den folgenden 
+// Funktionen sowie in lcd_write(), led(), get_keys(), delay_ms(),      
+// usart_init(). Das EEPROM wird ueber <avr/eeprom.h> und den EE_RDY-  
+// Interrupt (ee_rdy_on(), ee_rdy_off()) angesprochen. Mit HOST_SIM werden diese Funktionen nicht uebersetzt, 
+// sondern von host/host_sim.c nachgebildet (Simulation auf dem PC).   
+void ports_init(void);
+void watchdog_off(void);
+void timer_init(void);
+void timer_reload(void);
+void power_save(unsigned long);
+unsigned char timer_count(void);
+void adc_start(char);
+int adc_read(void);
+void adc_off(void);
+void adc_sleep(void);
+char usart_getc(void);
+void usart_off(void);
+void usart_write(char);
+void usart_tx_on(void);
+void usart_tx_off(void);
+char usart_tx_done(void);
+void usart_baud(unsigned int);
+void ee_rdy_on(void);
+void ee_rdy_off(void);
+unsigned int stack_unused(void);
+
+// Stackmessung: der freie SRAM-Bereich zwischen .bss und Stack wird beim 
+// Start mit STACK_PAINT gefuellt, stack_unused() zaehlt die Bytes, die  
+// der Stack seitdem nie erreicht hat (Befehl 106, host/avr_ram.sh).     
+#define STACK_PAINT 0xC5
+
+// Messpunkte der Laufzeitmessung in der Hauptschleife (host/host_sim.c), 
+// auf dem AVR leer                                                       
+#ifndef BENCH_SECTION
+#define BENCH_SECTION(s)
+#endif
 
 //*********
 // M I S C 
@@ -134,58 +312,218 @@ double accu_voltage = 0; //Akkuspannung
 //*************
 #define LCD_INST 0x00
 #define LCD_DATA 0x01
+#define LCD_ROWS 2
+#define LCD_COLS 16
+
+// Wartezeiten in lcd_write(), beim Uebersetzen waehlbar (-DLCD_TIMING=...). 
+// Die Initialisierung in lcd_init() wartet immer wie bisher in ms.         
+#define LCD_TIMING_MS 0      // 1 ms vor jedem Byte (wie frueher, langsame Displays) 
+#define LCD_TIMING_US 1      // feste Ausfuehrungszeit LCD_EXEC_US nach jedem Byte   
+#define LCD_TIMING_BUSY 2    // Busy-Flag lesen, R/W des Displays an PC5            
+#ifndef LCD_TIMING
+#define LCD_TIMING LCD_TIMING_US
+#endif
+#define LCD_EXEC_US 50       // HD44780: 37 us bei 270 kHz, Reserve fuer langsamere 
+unsigned char lcd_timing = LCD_TIMING;  // fuer host/host_sim.c 
+
+// Die lcd_put*-Funktionen schreiben nur in lcd_buf, lcd_flush() sendet 
+// die Zeichen, die sich gegenueber lcd_disp (Inhalt des Displays)      
+// geaendert haben. Aufgerufen vor jeder Tastenabfrage und Wartezeit   
+// (get_keys(), wait_ms()) und einmal pro Durchlauf der Hauptschleife. 
+char lcd_buf[LCD_ROWS][LCD_COLS], lcd_disp[LCD_ROWS][LCD_COLS];
 
 void lcd_write(char, unsigned char, int);
+void lcd_flush(void);
 void set_rs(char);
 void set_e(char);
+void lcd_wait_busy(void);
 void lcd_init(void);
 void lcd_cls(void);
 void lcd_linecls(int, int);
 void lcd_putchar(int, int, unsigned char);
 void lcd_putstring(int, int, char*);
+void lcd_putstring_P(int, int, const char*);
 int lcd_putnumber(int, int, int, int, int, char, char);
 void wait_ms(int);
+void delay_ms(int);
 void lcd_printdiveinfo(int, int, int);
 
 //*******
 // USART 
 //*******
+// Befehle vom PC, jeder Befehl wird vollstaendig zurueckgesendet (quittiert): 
+//                                                                             
+//   100 AL AH          1 Byte lesen, Antwort: Byte, CRC (XOR)                 
+//   101 AL AH B CRC    1 Byte schreiben, CRC = XOR der ersten 4 Bytes         
+//   102 AL AH NL NH    N Bytes ab Adresse A lesen (Blockuebertragung)         
+//   103 AL AH          Blockuebertragung ab Adresse A wiederholen/fortsetzen  
+//                      (Ende wie beim letzten Befehl 102)                     
+//   104 R CRC          auf Baudrate R (baud_ubrr) umschalten, CRC = 104 ^ R   
+//   105 R CRC          neue Baudrate bestaetigen (mit der neuen Rate senden)  
+//   106                Stackreserve lesen, Antwort: NL NH CRC (XOR ueber      
+//                      106, NL, NH), N = nie benutzte Bytes (stack_unused())  
+//                                                                             
+// Baudratenwechsel: Nach der Quittung von 104 (noch mit der alten Rate)      
+// schaltet der SBTC um. Kommt innerhalb von BAUD_TIMEOUT s kein fehlerfreies 
+// 105 mit derselben Rate, geht er auf die Grundrate (2.4 kBaud) zurueck,    
+// ebenso bei jedem anderen Zeichen. Die Verbindung beginnt immer mit der    
+// Grundrate.                                                                
+//                                                                             
+// Die Blockuebertragung sendet Bloecke mit bis zu BLK_SIZE Bytes:            
+//   AL AH N D1 .. DN CH CL                                                    
+// CH CL = CRC-16 (CCITT, 0x1021, Startwert 0xFFFF) ueber AL bis DN.           
+// Ein Block mit N = 0 beendet die Uebertragung.                               
 #define RX_BUF_SIZE 32
+#define BLK_SIZE 16
+#define BAUD_RATES 4
+#define BAUD_TIMEOUT 2  // [s] 
 
 void usart_init(void);
 void usart_putc(char);
+void usart_send_block(void);
+void usart_baud_cmd(void);
+void usart_baud_task(void);
 void clear_rx_buf(void);
 char make_crc(int, int);
+uint16_t make_crc16(uint16_t, unsigned char);
 void sbtc2pc(void);
 
 char rx_buf[RX_BUF_SIZE];
 unsigned char rx_buf_cnt = 0;
 
+// Sendepuffer (Ring), wird von SIG_UART_DATA geleert. usart_putc() wartet 
+// nie, bei vollem Puffer wird das Zeichen verworfen und gezaehlt.        
+#define TX_BUF_SIZE 32  // Zweierpotenz 
+#define TX_BUF_MASK (TX_BUF_SIZE - 1)
+
+char tx_buf[TX_BUF_SIZE];
+volatile unsigned char tx_head = 0, tx_tail = 0;  // schreiben / senden 
+unsigned char tx_buf_max = 0;   // Hoechststand des Puffers 
+unsigned int tx_dropped = 0;    // verworfene Zeichen 
+
+// Blockuebertragung (Befehl 102/103), wird in SIG_UART_RECV gesetzt 
+unsigned int blk_adr = 0, blk_end = 0;  // naechste Adresse, Ende (ausschl.) 
+char blk_run = 0;                       // Bloecke oder Endeblock ausstehend 
+
+// Baudraten (UBRR mit U2X bei 8 MHz): 2.4k (von Hand abgeglichen, wie 
+// frueher 220 ohne U2X), 9.6k, 19.2k, 38.4k (je 0.2 % Fehler)         
+const unsigned int baud_ubrr[BAUD_RATES] PROGMEM = {441, 103, 51, 25};
+char baud_cur = 0;         // eingestellte Rate 
+signed char baud_next = -1;  // angeforderte Rate, -1 = keine 
+char baud_test = 0;        // Bestaetigung (105) ausstehend 
+unsigned long baud_time;   // Zeitpunkt der Umschaltung [s] 
+
 //***********************
 // Dekompressionrechnung 
 //***********************
 #define NCOMP 16   // Anzahl der Kompartimente des Modells 
 #define FN2 0.78   // N2-Anteil im Atemgas                 
 #define MAX_DECO_STEPS 10
+#define DECO_STOP_MAX 9999 // Obergrenze fuer die Dauer einer Dekostufe [min] 
+#define DECO_STEP_MIN 10   // Dauer einer Dekostufe [min], ab der die Restdauer analytisch bestimmt wird 
 #define MAXGASES 3
 
+// Zahlenformat der Gewebe- und Dekorechnung. Mit DECO_FIXPOINT wird 
+// ganzzahlig gerechnet: Druecke und Koeffizienten im Format Q8.24   
+// (bar * 2^24), Zeiten im Format Q16.16 (min * 2^16). Q16.16 reicht 
+// fuer die Druecke nicht, da die Koeffizienten der langsamen        
+// Kompartimente (10 s bei t05 = 635 min: 1.8e-4) sonst um mehrere   
+// Prozent verfaelscht wuerden.                                     
+// Ohne DECO_FIXPOINT wird wie bisher mit float (Soft-Float) gerechnet.
+//#define DECO_FIXPOINT
+
+#ifdef DECO_FIXPOINT
+typedef int32_t pres_t;  // Druck [bar] Q8.24 
+typedef int32_t tmin_t;  // Zeit [min] Q16.16 
+#define PFIX(x) ((pres_t) ((x) * 16777216.0 + 0.5))  // Nur fuer Werte >= 0 
+#define PFLOAT(p) ((p) * (1.0 / 16777216))
+#define PINT(p) ((int) ((p) >> 24))
+#define TFIX(x) ((tmin_t) ((x) * 65536.0 + 0.5))
+#define TFLOAT(t) ((t) * (1.0 / 65536))
+#define TINT(t) ((int) ((t) >> 16))
+#define PMUL(a, b) fx_mul(a, b)   // Ergebnis im Format von b 
+#define PDIV(a, b) fx_div(a, b)
+#define PLOG2(p) fx_log2(p)
+#define P_ONE ((pres_t) 1 << 24)
+#define TFROMINT(m) ((tmin_t) (m) << 16)
+#define PGM_PRES(p) ((pres_t) pgm_read_dword(p))  // Tabellenwert aus dem Flash 
+#define PGM_TMIN(p) ((tmin_t) pgm_read_dword(p))
+
+pres_t fx_mul(pres_t, pres_t);
+pres_t fx_div(pres_t, pres_t);
+pres_t fx_log2(pres_t);
+#else
+typedef float pres_t;
+typedef float tmin_t;
+#define PFIX(x) (x)
+#define PFLOAT(p) (p)
+#define PINT(p) ((int) (p))
+#define TFIX(x) (x)
+#define TFLOAT(t) (t)
+#define TINT(t) ((int) (t))
+#define PMUL(a, b) ((a) * (b))
+#define PDIV(a, b) ((a) / (b))
+#define PLOG2(p) (log(p) / log(2))
+#define P_ONE 1.0
+#define TFROMINT(m) ((tmin_t) (m))
+#define PGM_PRES(p) pgm_read_float(p)
+#define PGM_TMIN(p) pgm_read_float(p)
+#endif
+
 // Gewebekonstanten fuer 16 Kompartimente  
 // STICKSTOFF                              
-float t05N2[] = {4, 8, 12.5, 18.5, 27, 38.3, 54.3, 77, 109, 146, 187, 239, 305, 390, 498, 635};
-float aN2[] = {1.2599, 1, 0.8618, 0.7562, 0.662, 0.5043, 0.441, 0.4,
-    0.375, 0.35, 0.3295, 0.3065, 0.2835, 0.261, 0.248, 0.2327};
-float bN2[] = {0.505, 0.6514, 0.7222, 0.7825, 0.8126, 0.8434, 0.8693, 0.891,
-    0.9092, 0.9222, 0.9319, 0.9403, 0.9477, 0.9544, 0.9602, 0.9653};
+// Halbwertszeiten in min., F(x, t05) wird fuer jedes Kompartiment expandiert 
+#define N2_HALFTIMES(F, x) F(x, 4), F(x, 8), F(x, 12.5), F(x, 18.5), F(x, 27), F(x, 38.3), F(x, 54.3), F(x, 77), \
+    F(x, 109), F(x, 146), F(x, 187), F(x, 239), F(x, 305), F(x, 390), F(x, 498), F(x, 635)
+#define T05_VALUE(x, t05) TFIX(t05)
+const tmin_t t05N2[NCOMP] PROGMEM = {N2_HALFTIMES(T05_VALUE, 0)};
+
+// Saettigungskoeffizienten 1 - 2^(-dt/t05) fuer die festen Rechenintervalle.  
+// Die Tabelle wird vom Compiler beim Uebersetzen aus den Halbwertszeiten      
+// berechnet (GCC faltet expm1() und log() mit konstanten Argumenten), zur    
+// Laufzeit faellt damit keine Exponentialfunktion mehr an. expm1 statt       
+// 1 - exp(), da bei 32-Bit-double sonst die Koeffizienten der langsamen      
+// Kompartimente durch Ausloeschung ungenau wuerden.                          
+#define SAT_COEFF(dt, t05) PFIX(-__builtin_expm1((-(dt) / (t05)) * log(2)))
+#define KINT_10S   0   // Gewebeupdate alle 10 s          
+#define KINT_1MIN  1   // Dekorechnung in 1-min-Schritten 
+#define KINT_60MIN 2   // Flugverbotszeit in 1-h-Schritten
+#define KINTS      3
+const pres_t kN2[KINTS][NCOMP] PROGMEM = {{N2_HALFTIMES(SAT_COEFF, 10.0 / 60)},
+                                         {N2_HALFTIMES(SAT_COEFF, 1.0)},
+                                         {N2_HALFTIMES(SAT_COEFF, 60.0)}};
+// a- und b-Werte fuer alle Toleranzfaktoren k = 10 * f (Menue 3 bis     
+// F_CONS_MAX, bei kaltem Wasser f_cons + 1), vom Compiler beim          
+// Uebersetzen berechnet: a = 2 * t05^(-1/3) / f, b = (1.005 - t05^(-1/2)) * f. 
+// set_ab_values() setzt aN2 und bN2 nur noch auf die passende Zeile,    
+// gelesen wird mit A_N2(i), B_N2(i).                                  
+// Obergrenze: ab f = 1.4 toleriert das langsamste Gewebe schon mit Luft 
+// gesaettigt mehr als den Kabinendruck 0.75 bar (Flugverbot endet nie), 
+// ab f = 1.5 bleibt nach einem TG eine Stufe auf 3 m, die nie frei wird 
+// (TG wird nicht abgeschlossen).                                       
+#define F_CONS_MAX 13
+#define AB_K_MIN 3
+#define AB_K_MAX (F_CONS_MAX + 1)
+#define A_VALUE(k, t05) PFIX(2 * __builtin_exp(-0.33333333 * __builtin_log(t05)) / ((k) * 0.1))
+#define B_VALUE(k, t05) PFIX((1.005 - __builtin_exp(-0.5 * __builtin_log(t05))) * ((k) * 0.1))
+#define AB_ROW(k) {{N2_HALFTIMES(A_VALUE, k)}, {N2_HALFTIMES(B_VALUE, k)}}
+const pres_t abN2[AB_K_MAX - AB_K_MIN + 1][2][NCOMP] PROGMEM = {
+    AB_ROW(3), AB_ROW(4), AB_ROW(5), AB_ROW(6), AB_ROW(7), AB_ROW(8), AB_ROW(9), AB_ROW(10),
+    AB_ROW(11), AB_ROW(12), AB_ROW(13), AB_ROW(14)};
+const pres_t *aN2, *bN2;             // aktuelle Zeile in abN2 
+#define A_N2(i) PGM_PRES(&aN2[i])
+#define B_N2(i) PGM_PRES(&bN2[i])
 
 // Kompartimentsaettigung 
-float piN2[] = {0.72, 0.72, 0.72, 0.72, 0.72, 0.72, 0.72, 0.72,
-    0.72, 0.72, 0.72, 0.72, 0.72, 0.72, 0.72, 0.72};
+pres_t piN2[] = {PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72),
+    PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72), PFIX(0.72)};
 
 // 3 durch Anwender waehlbare Gasgemische aus O2 und N2 (Gas1 = Luft) 
 unsigned char curgas = 0;
 double figN2[MAXGASES] = {FN2, 0.36, 0};              // N2-Anteil in 3 Auswahlgasen    
 
 float airp = 0.995;                  // Umgebungsluftdruck in bar am Tauchort        
+pres_t airp_p = PFIX(0.995);         // dto. im Zahlenformat der Dekorechnung        
 float airp0 = 0.995;                 // Umgebungsluftdruck in bar auf NN             
 float cabinp = 0.75;                 // Kabinendruck im Flugzeug in bar              
 int altitude = 0;                    //Hoehe ueber NN                                
@@ -203,15 +541,72 @@ unsigned char rcd_decotime[MAX_DECO_STEPS] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 unsigned char rcd_deco_minutes_total = 0;
 unsigned char tmp_decotime_total = 0;
 
+// Die Dekorechnung laeuft in Zeitscheiben: calc_deco() haelt die         
+// Gewebewerte fest, deco_step() rechnet bei jedem Aufruf (jede Sekunde)  
+// hoechstens DECO_SLICE Dekominuten fuer alle Kompartimente weiter.      
+// Erst der fertige Plan ersetzt deco_minutes_total und die Anzeige,    
+// deepest_decostep steht schon nach der ersten Stufe fest (vorher gilt  
+// hoechstens die erste Stufe). Die Ergebnisse sind dieselben wie in     
+// einem Zug.                                                            
+#define DECO_SLICE 20                // Dekominuten pro deco_step()              
+#define DECO_SHOW 8                  // angezeigte Stufen (16 Zeichen)           
+#define DECO_IDLE 0                  // Zustand: keine Rechnung                   
+#define DECO_STEP 1                  // neue Stufe beginnen                       
+#define DECO_MINUTE 2                // Minuten auf der Stufe rechnen             
+pres_t deco_snap[NCOMP];             // Gewebe zu Beginn der Rechnung             
+pres_t deco_px[NCOMP];               // Gewebe waehrend der Rechnung              
+pres_t deco_piig, deco_pamblim;      // Inertgasdruck, naechste Stufe            
+unsigned char deco_state = DECO_IDLE;
+char deco_fast, deco_pending;        // mit Abschaetzung, neue Werte liegen vor   
+unsigned int deco_decostep;          // laufende Stufe [m]                        
+unsigned int deco_m, deco_skipped, deco_adv;  // Minute, uebersprungen bis, noch fortzuschreiben 
+unsigned int deco_minutes1, deco_total;
+unsigned int deco_deepest;
+unsigned char deco_time[MAX_DECO_STEPS];      // Plan fuer rcd_decotime 
+unsigned char deco_show_min[DECO_SHOW];       // angezeigte Stufenzeiten  
+unsigned char deco_show_cnt;
+unsigned char show_min[DECO_SHOW], show_cnt = 0;  // veroeffentlichter Plan 
+
+// Bedingungen der letzten Rechnung: calc_deco() rechnet nur neu, wenn     
+// sich Tiefe (um DECO_DEPTH_TOL), Gas, Toleranzen, erste Stufe oder     
+// fuehrendes Kompartiment geaendert haben. Ein Plan mit Stopps gilt     
+// hoechstens DECO_MAX_AGE s, da die Stufenzeiten auch bei gleicher      
+// Ceiling wachsen, und nur tiefer als 3 m unter der tiefsten Stufe.     
+// Ohne Stopps wird ab einer Nullzeit von DECO_NDT_MIN min immer neu     
+// gerechnet, damit das Ende der Nullzeit nicht verspaetet erkannt wird. 
+#define DECO_DEPTH_TOL 10            // [dm] 
+#define DECO_MAX_AGE 30              // [s] 
+#define DECO_NDT_MIN 5               // [min] 
+char deco_valid = 0;
+int deco_ref_depth;
+unsigned char deco_ref_gas, deco_ref_comp;
+unsigned int deco_ref_stop;
+const pres_t *deco_ref_ab;
+unsigned long deco_ref_time;
+int deco_ndt = 0;                    // zuletzt angezeigte Nullzeit [min] 
+
+// Zwischenspeicher fuer calc_no_fly_time() 
+#define NFT_MAX (48 * 60)              // Obergrenze der Flugverbotszeit [min]          
+unsigned long nft_end;               // Ende der Flugverbotszeit [runseconds]        
+unsigned char nft_valid = 0;
+
 unsigned char surfaced = 0, ppo2_exceeded = 0;
 unsigned char decostep_skipped = 0, ndt_runout = 0; // Flags fuer Ereignisaufzeichnung im Profilespeicher 
 unsigned char temp_low = 0;
 
-float get_water_pressure(int);
+pres_t get_water_pressure(int);
 void calc_p_inert_gas(int);
-float get_water_depth(float);
+int get_water_depth(pres_t);
 int calc_ndt(void);
 void calc_deco(void);
+void deco_step(void);
+void deco_start(void);
+unsigned int deco_first_stop(pres_t*, unsigned char*);
+void deco_publish(void);
+void deco_show(void);
+pres_t deco_minute(pres_t*, pres_t);
+unsigned int deco_stop_estimate(pres_t*, pres_t, pres_t);
+void deco_advance(pres_t*, pres_t, unsigned int);
 unsigned int calc_no_fly_time(void);
 void get_dsensor(void);
 void get_tsensor(void);
@@ -229,22 +624,244 @@ int maxppo2 = 16;  // 1.6 bar
 int calc_ppo2(char);
 void calc_cns_otu(void);
 
+// ZNS- und OTU-Dosis je 10 s fuer ppO2 = 0.50 bis 2.00 bar in Schritten  
+// von 0.01 bar (darueber gilt der letzte Wert), Einheit 2^-16 % bzw.     
+// 2^-16 OTU. Der Compiler berechnet die Tabellen beim Uebersetzen:       
+// ZNS-Zeitgrenzen T [min] der NOAA-Tabelle fuer 0.6 bis 1.6 bar (linear 
+// interpoliert, bis 1.7 bar wie bei 1.6), ab 1.7 bar T = 312 * ppO2 + 72, 
+// OTU/min = (2 * (ppO2 - 0.5))^0.83.                                      
+#define PPO2_TAB_MIN 50   // [0.01 bar] 
+#define PPO2_TAB_MAX 200
+#define CNS_T_DAY(i) ((i) <= 0 ? 720 : (i) == 1 ? 570 : (i) == 2 ? 450 : (i) == 3 ? 360 : (i) == 4 ? 300 : \
+    (i) == 5 ? 270 : (i) == 6 ? 240 : (i) == 7 ? 210 : (i) == 8 ? 180 : (i) == 9 ? 165 : 150)
+#define CNS_T_DIVE(i) ((i) <= 0 ? 720 : (i) == 1 ? 570 : (i) == 2 ? 450 : (i) == 3 ? 360 : (i) == 4 ? 300 : \
+    (i) == 5 ? 240 : (i) == 6 ? 210 : (i) == 7 ? 180 : (i) == 8 ? 150 : (i) == 9 ? 120 : 45)
+#define CNS_T(T, c) ((c) >= 170 ? 312 * (c) * 0.01 + 72 : (c) >= 160 ? T(10) : \
+    T(((c) - 60) / 10) + (T(((c) - 60) / 10 + 1) - T(((c) - 60) / 10)) * (((c) - 60) % 10) / 10.0)
+#define CNS_DOSE(T, c) ((c) < 60 ? 0 : (uint16_t) (100.0 / 6 / CNS_T(T, c) * 65536 + 0.5))
+#define CNS_DAY(c) CNS_DOSE(CNS_T_DAY, c)
+#define CNS_DIVE(c) CNS_DOSE(CNS_T_DIVE, c)
+#define OTU_DOSE(c) ((c) <= 50 ? 0 : (uint16_t) (__builtin_pow(2 * ((c) * 0.01 - 0.5), 0.83) / 6 * 65536 + 0.5))
+#define PPO2_ROW(F, c) F(c), F(c + 1), F(c + 2), F(c + 3), F(c + 4), F(c + 5), F(c + 6), F(c + 7), F(c + 8), F(c + 9)
+#define PPO2_STEPS(F) PPO2_ROW(F, 50), PPO2_ROW(F, 60), PPO2_ROW(F, 70), PPO2_ROW(F, 80), PPO2_ROW(F, 90), \
+    PPO2_ROW(F, 100), PPO2_ROW(F, 110), PPO2_ROW(F, 120), PPO2_ROW(F, 130), PPO2_ROW(F, 140), PPO2_ROW(F, 150), \
+    PPO2_ROW(F, 160), PPO2_ROW(F, 170), PPO2_ROW(F, 180), PPO2_ROW(F, 190), F(200)
+const uint16_t cns_day_tab[PPO2_TAB_MAX - PPO2_TAB_MIN + 1] PROGMEM = {PPO2_STEPS(CNS_DAY)};
+const uint16_t cns_dive_tab[PPO2_TAB_MAX - PPO2_TAB_MIN + 1] PROGMEM = {PPO2_STEPS(CNS_DIVE)};
+const uint16_t otu_tab[PPO2_TAB_MAX - PPO2_TAB_MIN + 1] PROGMEM = {PPO2_STEPS(OTU_DOSE)};
+
+//*****************
+// Einstellungen   
+//*****************
+// Alle Einstellungen stehen als ein Block mit Pruefsumme ab CFG_ADR im  
+// EEPROM. cfg_load() liest ihn beim Start in einem Zug, cfg_save()    
+// schreibt nur die Bytes, die sich gegenueber dem Abbild cfg geaendert 
+// haben. Ist die Pruefsumme falsch, gelten die Einzelwerte der alten   
+// Firmware (Adressen 0..23), nach dem Loeschen die Vorgaben oben.      
+// Feste Breiten und ohne Fuellbytes, damit er auf dem PC gleich ist.  
+#define CFG_ADR 0
+#define CFG_VERSION 1
+
+struct config
+{
+    uint16_t crc;              // CRC-16 (wie make_crc16) ueber alle folgenden Bytes 
+    uint16_t airp0;            // Luftdruck auf NN [mbar] 
+    uint16_t altitude;         // Hoehe ueber NN [m] 
+    uint16_t cabinp;           // Kabinendruck im Flugzeug [mbar] 
+    uint8_t version;           // CFG_VERSION 
+    uint8_t maxppo2;           // [0.1 bar] 
+    uint8_t f_cons;            // Konservativfaktor (10facher Wert) 
+    uint8_t show_ppN2;
+    uint8_t show_settings;
+    uint8_t figN2[MAXGASES];   // N2-Anteil [%] 
+    uint8_t swversion[3];      // Softwareversion, die den Block geschrieben hat 
+    uint8_t spare[5];          // frei, der Block belegt wie bisher 0..23 
+};
+struct config cfg;             // Abbild des Blocks im EEPROM 
+
+uint16_t cfg_crc(struct config*);
+void cfg_load(void);
+void cfg_save(struct config*);
+
 //************
 // AD-Wandler 
 //************
-#define ADWAITSTATE 3
-int adc_val;
-char adc_mode = 0; // 0=Druck, 1=Temperatur, 2=Akkuspannung
+// Der Timer-Interrupt startet zu jeder Sekunde eine Messreihe: SIG_ADC    
+// wandelt die Kanaele nacheinander je ADC_OVERSAMPLE mal und schaltet den 
+// Wandler danach wieder ab (ca. 8 ms). Dazwischen, bei den uebrigen       
+// TICKS_PER_S - 1 Timerueberlaeufen, wird nur der Drucksensor gemessen    
+// (ca. 5 ms), jeder Tiefenwert geht in depth_filter(). Nach dem          
+// Einschalten werden ADC_SETTLE Wandlungen verworfen, bis die interne     
+// Referenz (0.1 uF an AREF) steht, nach jedem Kanalwechsel eine. Die Summe von 16 Wandlungen / 4 ergibt    
+// 12 Bit, d.h. bei Rauschen ab 1 LSB 2 Bit mehr Aufloesung.               
+// adc_wait() schlaeft (ADC Noise Reduction), bis der Kanal fertig ist.    
+#define ADC_DEPTH 0       // PA0 PIN 40, Drucksensor, 1 LSB = 1 dm 
+#define ADC_TEMP 1        // PA1 PIN 39, KTY 81-210 
+#define ADC_VOLT 2        // PA2 PIN 38, Spannungsteiler Akku 
+#define ADC_CHANNELS 3
+#define ADC_OVERSAMPLE 16
+#define ADC_SETTLE 30     // ca. 3 ms (104 us je Wandlung bei 125 kHz) 
+
+volatile unsigned int adc_result[ADC_CHANNELS];  // 4facher 10-Bit-Wert 
+volatile unsigned char adc_done = 0;  // Bit je Kanal: in dieser Messreihe fertig 
+volatile unsigned char adc_busy = 0;  // Messreihe laeuft 
+unsigned char adc_ch;                 // laufender Kanal 
+unsigned char adc_last;               // letzter Kanal der Messreihe 
+signed char adc_cnt;                  // Wandlungen des Kanals, < 0 verwerfen 
+unsigned int adc_sum;
+
+void adc_burst(unsigned char);
+void adc_wait(unsigned char);
+
+//****************************
+// Tiefenfilter, Aufstieg     
+//****************************
+// Alpha-Beta-Filter ueber die Tiefenwerte (in SIG_ADC, TICKS_PER_S mal pro 
+// Sekunde): Vorhersage x + v, der Messfehler geht mit DFLT_ALPHA in die     
+// Tiefe und mit DFLT_BETA in die Geschwindigkeit ein. Nur Schiebe- und     
+// Additionsbefehle in Festkomma: x in 1/4 dm * 256, v in 1/4 dm pro        
+// Timerueberlauf * 256. Beta etwa Alpha^2 / (2 - Alpha) (Benedict-      
+// Bordner). Die Geschwindigkeit schwingt nach einem Wechsel um ca. 10 %  
+// ueber, die Warnung kommt daher erst, wenn sie ASCENT_TICKS Werte in   
+// Folge ueber ASCENT_MAX liegt.                                         
+#define DFLT_ALPHA 1      // Alpha = 1/2 (Schiebeweite) 
+#define DFLT_BETA 3       // Beta = 1/8 
+#define ASCENT_MAX 100    // Aufstiegswarnung ab [dm/min] 
+#define ASCENT_TICKS (3 * TICKS_PER_S)  // Werte in Folge ueber ASCENT_MAX (3 s) 
+#define DFLT_V_ASCENT (ASCENT_MAX * 256L * 4 / (60 * TICKS_PER_S))  // ASCENT_MAX in Einheiten von dflt_v 
+
+volatile long dflt_x;                 // gefilterte Tiefe 
+volatile long dflt_v;                 // Vertikalgeschwindigkeit, > 0 abtauchen 
+volatile unsigned char dflt_init = 0; // Filter hat Startwert 
+volatile unsigned char dflt_asc = 0;  // Werte in Folge ueber ASCENT_MAX 
+int depth_rate = 0;                   // Vertikalgeschw. [dm/min], < 0 aufsteigen 
+unsigned char ascent_fast = 0;        // Aufstiegswarnung aktiv 
+
+void depth_filter(unsigned int);
 
 //********************************************************//
 // Funktionen und Prozeduren fuer Dekompressionsrechnung //
 //******************************************************//
 
+#ifdef DECO_FIXPOINT
+// Produkt a * b / 2^24 (a im Format Q8.24, Ergebnis im Format von b), 
+// ohne 64-Bit-Arithmetik in vier 32-Bit-Teilprodukte zerlegt          
+pres_t fx_mul(pres_t a, pres_t b)
+{
+    char neg = 0;
+    uint32_t ua = a, ub = b, r;
+    uint16_t ah, al, bh, bl;
+
+    if(a < 0)
+    {
+        neg = 1;
+        ua = -a;
+    }
+    if(b < 0)
+    {
+        neg ^= 1;
+        ub = -b;
+    }
+
+    // 16x16-Bit-Teilprodukte (MUL-Befehl des ATmega) 
+    ah = ua >> 16;
+    al = ua;
+    bh = ub >> 16;
+    bl = ub;
+
+    // Mittlere Teilprodukte zusammenfassen und gerundet schieben, damit sich 
+    // bei tausenden Gewebeschritten kein Abschneidefehler aufsummiert        
+    r = (uint32_t) ah * bl + (uint32_t) al * bh + (((uint32_t) al * bl) >> 16);
+    r = (((uint32_t) ah * bh) << 8) + ((r + 0x80) >> 8);
+
+    if(neg)
+        return -(pres_t) r;
+    return r;
+}
+
+// Quotient zweier Q8.24-Werte (Ganzzahlteil + 24 Bit schriftliche Division) 
+pres_t fx_div(pres_t a, pres_t b)
+{
+    char neg = 0;
+    uint32_t ua = a, ub = b, q, r;
+    unsigned char t1;
+
+    if(!b)
+        return INT32_MAX;
+
+    if(a < 0)
+    {
+        neg = 1;
+        ua = -a;
+    }
+    if(b < 0)
+    {
+        neg ^= 1;
+        ub = -b;
+    }
+
+    q = ua / ub;
+    if(q > 0x7F) // Ergebnis nicht darstellbar 
+        return neg ? -INT32_MAX : INT32_MAX;
+    r = ua - q * ub;
+
+    for(t1 = 0; t1 < 24; t1++)
+    {
+        r <<= 1;
+        q <<= 1;
+        if(r >= ub)
+        {
+            r -= ub;
+            q |= 1;
+        }
+    }
+
+    if(neg)
+        return -(pres_t) q;
+    return q;
+}
+
+// Zweierlogarithmus eines positiven Q8.24-Wertes: Ganzzahlteil durch 
+// Normieren auf [1; 2), 16 Nachkommabits durch fortgesetztes Quadrieren 
+pres_t fx_log2(pres_t x)
+{
+    pres_t r = 0, bit = P_ONE / 2;
+    unsigned char t1;
+
+    if(x <= 0)
+        return -24 * P_ONE;
+
+    while(x >= 2 * P_ONE)
+    {
+        x >>= 1;
+        r += P_ONE;
+    }
+    while(x < P_ONE)
+    {
+        x <<= 1;
+        r -= P_ONE;
+    }
+
+    for(t1 = 0; t1 < 16; t1++)
+    {
+        x = fx_mul(x, x);
+        if(x >= 2 * P_ONE)
+        {
+            x >>= 1;
+            r += bit;
+        }
+        bit >>= 1;
+    }
+
+    return r;
+}
+#endif
+
 // Wasserdruck p.amb aus Tiefe depth  
 // berechnen                          
-float get_water_pressure(int depth)
+pres_t get_water_pressure(int depth)
 {
-    return depth * 0.1 + airp;
+    return depth * PFIX(0.1) + airp_p;
 }
 
 // Inertgaspartialdruck im Gewebe berechnen 
@@ -252,16 +869,27 @@ float get_water_pressure(int depth)
 void calc_p_inert_gas(int d)
 {
     unsigned char t1;
-    float pamb = get_water_pressure(d) - 0.0627;
+    pres_t pamb = get_water_pressure(d) - PFIX(0.0627);
+    pres_t piigN2 = PMUL(pamb, PFIX(figN2[curgas]));
 
     for(t1 = 0; t1 < NCOMP; t1++)
-        piN2[t1] += (pamb * figN2[curgas] - piN2[t1]) * (1 - exp((-0.1667 / t05N2[t1]) * log(2)));
+        piN2[t1] += PMUL(piigN2 - piN2[t1], PGM_PRES(&kN2[KINT_10S][t1]));
+
+    // Flugverbotszeit bleibt gueltig, solange an der Oberflaeche Luft 
+    // (FN2) geatmet wird (Gewebe folgt dann der berechneten            
+    // Entsaettigung). Gas 1 kann im Menue veraendert sein, daher den  
+    // N2-Anteil pruefen. Nicht ueber piigN2 pruefen: calc_no_fly_time() 
+    // rechnet ihn anders und trifft ihn nicht immer bitgenau.          
+    if(d || PFIX(figN2[curgas]) != PFIX(FN2))
+        nft_valid = 0;
 }
 
-// Wassertiefe depth aus p.amb berechnen 
-float get_water_depth(float pamb)
+// Wassertiefe depth in m (abgeschnitten, >= 0) aus p.amb berechnen 
+int get_water_depth(pres_t pamb)
 {
-    return (pamb - airp) * 10;
+    if(pamb <= airp_p)
+        return 0;
+    return PINT((pamb - airp_p) * 10);
 }
 
 // Errechnen der Restnullzeit 
@@ -271,23 +899,22 @@ int calc_ndt()
     unsigned char t1;
 
     int dp = depth * 0.1; // Wassertiefe in m 
-    int t0min = 999;
+    tmin_t te, t0min = TFIX(999);
+    pres_t xN2;
+    pres_t piigN2, pamb = get_water_pressure(dp) - PFIX(0.0627);
 
-    float te, xN2;
-    float piigN2, pamb = get_water_pressure(dp) - 0.0627;
-
-    piigN2 = pamb * figN2[curgas];
+    piigN2 = PMUL(pamb, PFIX(figN2[curgas]));
 
     for(t1 = 0; t1 < NCOMP; t1++)
     {
         // Anwendung der Logarithmusgleichung 
         if(piigN2  - piN2[t1] && figN2[curgas])
         {
-          xN2 = -1 * ((airp / bN2[t1] + aN2[t1] - piN2[t1]) / (piigN2 - piN2[t1]) - 1);
+          xN2 = P_ONE - PDIV(PDIV(airp_p, B_N2(t1)) + A_N2(t1) - piN2[t1], piigN2 - piN2[t1]);
 
             if(xN2 > 0) // Ist Logarithmieren moeglich? 
             {
-                te = -1 * log(xN2) / log(2) * t05N2[t1];
+                te = PMUL(-PLOG2(xN2), PGM_TMIN(&t05N2[t1]));
                 if(te < t0min)
                     t0min = te;
                 calcok = 1;
@@ -298,7 +925,7 @@ int calc_ndt()
     if(calcok && dp > 10)
     {
         if(t0min > 0)
-            return (int) t0min;
+            return TINT(t0min);
         else
             return 0;
    }
@@ -309,100 +936,347 @@ int calc_ndt()
 }
 
 
-// Dekompressionsstufen berechnen 
-void calc_deco()
+// Eine Minute auf der Dekostufe simulieren (Inertgasdruck im Atemgas piigN2), 
+// Rueckgabe: groesster tolerierter Umgebungsdruck aller Kompartimente      
+pres_t deco_minute(pres_t *piN2x, pres_t piigN2)
 {
-    float piN2x[NCOMP];
-    float pambtol, pambtolmax = 1.0;
-    unsigned int decostep, deco_minutes1 = 0;
-    unsigned char xpos = 0, t1, t2;
-    unsigned char tmp_decotime[MAX_DECO_STEPS];
-    unsigned int cnt = 0;
-    int ndt;
+    unsigned char t1;
+    pres_t pambtol, pambtolmax = 0;
 
-    for(t1 = 0; t1 < MAX_DECO_STEPS; t1++)
-        tmp_decotime[t1] = 0;
+    for(t1 = 0; t1 < NCOMP; t1++)
+    {
+        piN2x[t1] += PMUL(piigN2 - piN2x[t1], PGM_PRES(&kN2[KINT_1MIN][t1]));
+        pambtol = PMUL(piN2x[t1] - A_N2(t1), B_N2(t1));
+        if(pambtol > pambtolmax)
+            pambtolmax = pambtol;
+    }
 
-    deco_minutes_total = 0;
+    return pambtolmax;
+}
 
-    // Signal LED ein 
-    led(2, 1);
+// Aufenthaltsdauer auf der Dekostufe abschaetzen, bis alle Kompartimente 
+// den Umgebungsdruck pamblim tolerieren. Die Haldane-Gleichung           
+//   p(t) = piigN2 + (p0 - piigN2) * 2^(-t / t05)                         
+// wird je Kompartiment nach t aufgeloest, das Maximum bestimmt die Stufe.
+// Rueckgabe in ganzen min. (auf +-1 min genau), DECO_STOP_MAX, wenn die  
+// Stufe mit dem Atemgas nicht frei wird, 0, wenn ein Kompartiment auf    
+// der Stufe erst noch aufsaettigt und keine Abschaetzung moeglich ist.   
+unsigned int deco_stop_estimate(pres_t *piN2x, pres_t piigN2, pres_t pamblim)
+{
+    unsigned char t1, tolig;
+    unsigned int m, mmax = 0;
+    pres_t ptol;
+    tmin_t t;
 
-    // Aktuelle Gasspannungen in temporaeres eindimensionales Datenfeld uebertragen 
     for(t1 = 0; t1 < NCOMP; t1++)
     {
-        piN2x[t1] = piN2[t1];
-        //pigx[t1] = piN2x[t1] + piHex[t1];
+        // Toleriert das Kompartiment pamblim noch, wenn es voll mit dem 
+        // Atemgas gesaettigt ist?                                       
+        tolig = PMUL(piigN2 - A_N2(t1), B_N2(t1)) < pamblim;
+
+        // Kompartiment toleriert die naechste Stufe schon ... 
+        if(PMUL(piN2x[t1] - A_N2(t1), B_N2(t1)) < pamblim)
+        {
+            if(!tolig) // ... aber nicht mehr lange 
+                return 0;
+            continue;
+        }
+
+        if(piN2x[t1] <= piigN2 || !tolig)
+            return DECO_STOP_MAX;
+
+        // Tolerierte Gewebespannung fuer pamblim 
+        ptol = PDIV(pamblim, B_N2(t1)) + A_N2(t1);
+        if(ptol <= piigN2)
+            return DECO_STOP_MAX;
+
+        t = PMUL(PLOG2(PDIV(piN2x[t1] - piigN2, ptol - piigN2)), PGM_TMIN(&t05N2[t1]));
+        if(t >= TFROMINT(DECO_STOP_MAX))
+            return DECO_STOP_MAX;
+
+        m = TINT(t) + 1;
+        if(m > mmax)
+            mmax = m;
     }
 
-    // Erste Dekostufe 
+    return mmax;
+}
+
+// Gewebe auf der Dekostufe um m Minuten fortschreiben, Rechenschritte wie 
+// in deco_minute(), aber ohne Toleranzberechnung                          
+void deco_advance(pres_t *piN2x, pres_t piigN2, unsigned int m)
+{
+    unsigned char t1;
+    unsigned int t2;
+    pres_t p, k;
+
     for(t1 = 0; t1 < NCOMP; t1++)
-        if((piN2x[t1] - aN2[t1]) * bN2[t1] > pambtolmax)
-            pambtolmax = (piN2x[t1] - aN2[t1]) * bN2[t1];
+    {
+        p = piN2x[t1];
+        k = PGM_PRES(&kN2[KINT_1MIN][t1]);
+        for(t2 = 0; t2 < m; t2++)
+            p += PMUL(piigN2 - p, k);
+        piN2x[t1] = p;
+    }
+}
+
+// Erste Dekostufe [m] (3-m-Stufe unter der Ceiling) fuer die Gewebewerte 
+// p, in *comp das fuehrende Kompartiment (NCOMP: keines ueber p.amb)      
+unsigned int deco_first_stop(pres_t *p, unsigned char *comp)
+{
+    pres_t pambtol, pambtolmax = P_ONE;
+    unsigned char t1;
 
-    decostep = get_water_depth(pambtolmax);
-    decostep = ((decostep / 3) + 1) * 3;
+    *comp = NCOMP;
+    for(t1 = 0; t1 < NCOMP; t1++)
+    {
+        pambtol = PMUL(p[t1] - A_N2(t1), B_N2(t1));
+        if(pambtol > pambtolmax)
+        {
+            pambtolmax = pambtol;
+            *comp = t1;
+        }
+    }
 
-    deepest_decostep = 0;
+    return (get_water_depth(pambtolmax) / 3 + 1) * 3;
+}
 
-    if(dphase)
-        lcd_linecls(1, 15);
+// Dekompressionsstufen berechnen: Gewebewerte festhalten und die Rechnung 
+// starten. Laeuft noch eine, wird danach mit den neuen Werten gerechnet.   
+// Ist der letzte Plan noch gueltig (siehe deco_valid), wird nur die      
+// Anzeige (Nullzeit) erneuert.                                          
+void calc_deco()
+{
+    unsigned char t1, comp;
+    unsigned int stop;
+    int ddepth;
 
-    get_dsensor();
+    if(deco_state != DECO_IDLE)
+    {
+        deco_pending = 1;
+        return;
+    }
 
-    // Nachfolgende Dekostufen bis 0 m Wassertiefe errechnen 
-    while(decostep > 0)
+    stop = deco_first_stop(piN2, &comp);
+    ddepth = depth > deco_ref_depth ? depth - deco_ref_depth : deco_ref_depth - depth;
+    if(deco_valid && ddepth < DECO_DEPTH_TOL && curgas == deco_ref_gas && aN2 == deco_ref_ab &&
+       stop == deco_ref_stop && comp == deco_ref_comp &&
+       (deco_minutes_total ? runseconds - deco_ref_time < DECO_MAX_AGE && depth >= (deepest_decostep + 3) * 10
+                           : deco_ndt > DECO_NDT_MIN))
     {
-        pambtolmax = 0.0;
+        deco_pending = 0;
+        deco_show();
+        return;
+    }
 
-        for(t1 = 0; t1 < NCOMP; t1++)
+    deco_valid = 1;
+    deco_ref_depth = depth;
+    deco_ref_gas = curgas;
+    deco_ref_ab = aN2;
+    deco_ref_stop = stop;
+    deco_ref_comp = comp;
+    deco_ref_time = runseconds;
+
+    // Der neue Plan beginnt hoechstens auf der ersten Stufe: ein alter, 
+    // tieferer Stopp darf bis dahin keine Markierung 223 ausloesen      
+    if((int) stop < deepest_decostep)
+        deepest_decostep = stop;
+
+    // Signal LED ein 
+    led(2, 1);
+
+    for(t1 = 0; t1 < NCOMP; t1++)
+        deco_snap[t1] = piN2[t1];
+    deco_pending = 0;
+    deco_fast = 1;
+    deco_start();
+}
+
+// Rechnung mit den festgehaltenen Gewebewerten (neu) beginnen 
+void deco_start(void)
+{
+    unsigned char t1;
+
+    deco_minutes1 = 0;
+    deco_total = 0;
+    deco_deepest = 0;
+    deco_show_cnt = 0;
+
+    for(t1 = 0; t1 < MAX_DECO_STEPS; t1++)
+        deco_time[t1] = 0;
+
+    // Aktuelle Gasspannungen in temporaeres eindimensionales Datenfeld uebertragen 
+    for(t1 = 0; t1 < NCOMP; t1++)
+        deco_px[t1] = deco_snap[t1];
+
+    // Erste Dekostufe (in calc_deco() fuer deco_snap bestimmt) 
+    deco_decostep = deco_ref_stop;
+    deco_state = DECO_STEP;
+}
+
+// Dekorechnung um hoechstens DECO_SLICE Minuten weiterfuehren           
+// Dauert eine Stufe laenger als DECO_STEP_MIN, wird ihre Restdauer mit  
+// deco_stop_estimate() analytisch bestimmt. Bis 3 min vor dem Ende wird 
+// das Gewebe dann mit deco_advance() ohne Toleranzpruefung              
+// fortgeschrieben, da die Stufe dort sicher noch nicht frei wird. Die   
+// Gewebewerte entstehen mit denselben Rechenschritten wie bisher, der   
+// Plan ist damit minutengenau gleich. Wird die Stufe schon in der       
+// ersten geprueften Minute frei (Abschaetzung zu lang), wird der Plan   
+// ohne Abschaetzung neu gerechnet.                                      
+void deco_step()
+{
+    pres_t pambtolmax;
+    unsigned int budget = DECO_SLICE, n, cnt;
+    unsigned char done;
+
+    while(deco_state != DECO_IDLE && budget)
+    {
+        if(deco_state == DECO_STEP)
         {
-            piN2x[t1] += ((get_water_pressure(decostep) - 0.0627) * figN2[curgas]  - piN2x[t1]) * (1 - exp((-1 / t05N2[t1]) * log(2)));
-            pambtol = (piN2x[t1] - aN2[t1]) * bN2[t1];
-            if(pambtol > pambtolmax)
-                pambtolmax = pambtol;
+            deco_piig = PMUL(get_water_pressure(deco_decostep) - PFIX(0.0627), PFIX(figN2[curgas]));
+            deco_pamblim = get_water_pressure(deco_decostep - 3); // Naechste Stufe (Tiefe < decostep - 3 m) 
+            deco_m = 0;
+            deco_skipped = 0;
+            deco_adv = 0;
+            deco_state = DECO_MINUTE;
         }
 
-        if(get_water_depth(pambtolmax) < decostep - 3)
+        // Uebersprungene Minuten fortschreiben 
+        if(deco_adv)
         {
-            if(deco_minutes1)
-                xpos += lcd_putnumber(1, xpos, deco_minutes1, -1, -1, 'l', 1) + 1;
+            n = deco_adv < budget ? deco_adv : budget;
+            deco_advance(deco_px, deco_piig, n);
+            deco_adv -= n;
+            budget -= n;
+            continue;
+        }
 
-            deco_minutes_total += deco_minutes1;
+        // Minutenweise rechnen, bis die Toleranz die naechste Stufe erlaubt 
+        deco_m++;
+        budget--;
+        pambtolmax = deco_minute(deco_px, deco_piig);
+        done = 0;
 
-            // Werte im Datenfeld speichern fuer EEPROM-Aufzeichnung       
-            cnt = (decostep / 3) - 1; // Nr. des Decostopp ermitteln 
-            if(cnt >= 0 && cnt < MAX_DECO_STEPS)
-                tmp_decotime[cnt] = deco_minutes1;
+        if(pambtolmax < deco_pamblim)
+        {
+            if(deco_skipped && deco_m == deco_skipped + 1) // Abschaetzung war zu lang 
+            {
+                deco_fast = 0;
+                deco_start();
+                continue;
+            }
+            done = 1;
+        }
+        else if(deco_m >= DECO_STOP_MAX)
+            done = 1;
 
-            decostep -= 3;
-            deco_minutes1 = 0;
+        // Lange Stufe: Minuten ohne Toleranzpruefung ueberspringen 
+        else if(deco_fast && deco_m == DECO_STEP_MIN)
+        {
+            n = deco_stop_estimate(deco_px, deco_piig, deco_pamblim);
+            if(n >= DECO_STOP_MAX) // Stufe wird nicht frei 
+            {
+                deco_m = DECO_STOP_MAX;
+                done = 1;
+            }
+            else if(n > 3)
+            {
+                deco_adv = n - 3;
+                deco_m += n - 3;
+                deco_skipped = deco_m;
+            }
         }
-        deco_minutes1 += 1;
 
-        // Laengste gesamte Dekozeit speichern 
-        if(deco_minutes_total > tmp_decotime_total)
+        if(!done)
+            continue;
+
+        // Stufe fertig 
+        deco_minutes1 += deco_m - 1;
+
+        // Tiefsten errechneten Dekostopp speichern (Stufe zaehlt erst, 
+        // wenn dort laenger als 1 min. gewartet werden muss)           
+        if(deco_m > 1 && deco_decostep > deco_deepest)
+            deco_deepest = deco_decostep;
+
+        if(deco_minutes1 && deco_show_cnt < DECO_SHOW)
+            deco_show_min[deco_show_cnt++] = deco_minutes1;
+
+        deco_total += deco_minutes1;
+
+        // Werte im Datenfeld speichern fuer EEPROM-Aufzeichnung       
+        cnt = (deco_decostep / 3) - 1; // Nr. des Decostopp ermitteln 
+        if(cnt < MAX_DECO_STEPS)
+            deco_time[cnt] = deco_minutes1;
+
+        deco_decostep -= 3;
+        deco_minutes1 = 1;
+
+        if(deco_decostep > deco_deepest)
+            deco_deepest = deco_decostep;
+
+        // Nach der ersten Stufe steht der tiefste Stopp fest 
+        if(deco_decostep + 3 == deco_ref_stop)
+            deepest_decostep = deco_deepest;
+
+        if(!deco_decostep)
         {
-            for(t2 = 0; t2 < MAX_DECO_STEPS; t2++)
-                rcd_decotime[t2] = tmp_decotime[t2];
-            tmp_decotime_total = deco_minutes_total;
+            deco_state = DECO_IDLE;
+            deco_publish();
         }
+        else
+            deco_state = DECO_STEP;
+    }
 
-        // Tiefsten errechneten Dekostopp speichern 
-        if(decostep > deepest_decostep)
-            deepest_decostep = decostep;
+    // Inzwischen neue Gewebewerte: gleich weiterrechnen 
+    if(deco_state == DECO_IDLE && deco_pending)
+        calc_deco();
+}
+
+// Fertigen Plan uebernehmen und anzeigen 
+void deco_publish(void)
+{
+    unsigned char t1;
+
+    deco_minutes_total = deco_total;
+    deepest_decostep = deco_deepest;
+    for(t1 = 0; t1 < deco_show_cnt; t1++)
+        show_min[t1] = deco_show_min[t1];
+    show_cnt = deco_show_cnt;
+
+    // Laengste gesamte Dekozeit speichern 
+    if(deco_minutes_total > tmp_decotime_total)
+    {
+        for(t1 = 0; t1 < MAX_DECO_STEPS; t1++)
+            rcd_decotime[t1] = deco_time[t1];
+        tmp_decotime_total = deco_minutes_total;
     }
 
+    deco_show();
+    led(2, 0);
+}
+
+// Dekostufen, Gesamtdekozeit bzw. Nullzeit in Zeile 2 anzeigen 
+void deco_show(void)
+{
+    unsigned char xpos = 0, t1;
+    int ndt;
+
+    if(dphase)
+        lcd_linecls(1, 15);
+
+    for(t1 = 0; t1 < show_cnt; t1++)
+        xpos += lcd_putnumber(1, xpos, show_min[t1], -1, -1, 'l', 1) + 1;
+
     if(dphase || deco_minutes_total) // Restliche Anzeige (Gesamtdekozeit bzw. Nullzeit nur, wenn getaucht wird) 
     {
         if(!deco_minutes_total)      // Gesamte Dekozeit <= 0 also NZ-TG 
         {
-            lcd_putstring(1, 0, "NZ: ");
+            lcd_putstring_P(1, 0, PSTR("NZ: "));
 
-            ndt = calc_ndt();
+            ndt = deco_ndt = calc_ndt();
 
             if(ndt < 0)       // Unplausible NZ-Werte abfangen 
-                lcd_putstring(1, 4, "-");
+                lcd_putstring_P(1, 4, PSTR("-"));
             else
             {
                 xpos = lcd_putnumber(1, 4, ndt, -1, -1, 'l', 1) + 4;
@@ -419,7 +1293,7 @@ void calc_deco()
 
             if(!ndt_runout) // Flag setzen fuer Profilaufzeichnung: Nullzeit zu Ende,  
             {               // PADIes muessen jetzt auftauchen! ;-P                     
-                eeprom_store_byte(225);
+                prof_store_marker(225);
                 ndt_runout = 1;
             }
 
@@ -428,67 +1302,73 @@ void calc_deco()
 
     if(xpos < 12)
         showtemp();
-
-    led(2, 0);
 }
 
 // Flugverbotszeit für N2-Kompartimente berechnen 
-// Aufloesung: 1 h              
+// Die Entsaettigung an der Oberflaeche (Luft) bis zur Toleranz des      
+// Kabinendrucks wird je Kompartiment aus der Haldane-Gleichung          
+//   p(t) = piigN2 + (p0 - piigN2) * 2^(-t / t05)                        
+// bestimmt, das Maximum ist die Flugverbotszeit. Aufloesung: 1 min.     
+// Das Ende der Flugverbotszeit wird zwischengespeichert, bis sich piN2  
+// anders als durch die Entsaettigung an der Oberflaeche aendert.        
 unsigned int calc_no_fly_time()
 {
-    float piN2_b[NCOMP];
-    float p_amb_tol;
-    unsigned int nft = 0, flag_no_fly, t1;
-
-    // Aktuelle Gasspannungen in temporaeres Datenfeld uebertragen 
-    for(t1 = 0; t1 < NCOMP; t1++)
-       piN2_b[t1] = piN2[t1];
+    pres_t ptol, cabin = PFIX(cabinp);
+    pres_t piigN2 = PMUL(airp_p - PFIX(0.0627), PFIX(FN2));
+    unsigned int nft = 0, m;
+    unsigned char t1;
+    tmin_t t;
 
-    while(nft < 48)
+    if(!nft_valid)
     {
-        flag_no_fly = 0;
-
         for(t1 = 0; t1 < NCOMP; t1++)
         {
-            piN2_b[t1] += ((airp - 0.0627) * 0.78 - piN2_b[t1]) * (1 - exp((-60 / t05N2[t1]) * log(2)));
-
-            p_amb_tol = (piN2_b[t1] - aN2[t1]) * bN2[t1];
-            if(p_amb_tol > cabinp) // Kabinendruck in bar 
-                flag_no_fly = 1;
+            // Kompartiment toleriert den Kabinendruck schon 
+            if(PMUL(piN2[t1] - A_N2(t1), B_N2(t1)) <= cabin)
+                continue;
+
+            // Tolerierte Gewebespannung fuer den Kabinendruck 
+            ptol = PDIV(cabin, B_N2(t1)) + A_N2(t1);
+            if(ptol <= piigN2)
+                return NFT_MAX;
+
+            t = PMUL(PLOG2(PDIV(piN2[t1] - piigN2, ptol - piigN2)), PGM_TMIN(&t05N2[t1]));
+            if(t >= TFROMINT(NFT_MAX))
+                return NFT_MAX; // >= 48 h wird nicht zwischengespeichert 
+
+            m = TINT(t) + 1;
+            if(m > nft)
+                nft = m;
         }
 
-        if(!flag_no_fly)
-            return nft;
-        nft++;
+        nft_end = runseconds + nft * 60UL;
+        nft_valid = 1;
     }
-    return nft;
+
+    if(nft_end <= runseconds)
+        return 0;
+    return (nft_end - runseconds + 59) / 60;
 }
 
-// Uebersaettigungstoleranzen veraendern 
+// Uebersaettigungstoleranzen veraendern: Zeile k der Tabelle abN2 waehlen 
 void set_ab_values(int k, unsigned char showmode)
 {
     unsigned char t1;
-    double f = k * 0.1;
 
-    for(t1 = 0; t1 < NCOMP; t1++)
-    {
-        aN2[t1] = 2 * exp(-0.33333333 * log(t05N2[t1]));
-        //aHe[t1] = 2 * exp(-0.33333333 * log(t05He[t1]));
-        bN2[t1] = 1.005 - exp(-0.5 * log(t05N2[t1]));
-        //bHe[t1] = 1.005 - exp(-0.5 * log(t05He[t1]));
-    }
+    if(k < AB_K_MIN)
+        k = AB_K_MIN;
+    if(k > AB_K_MAX)
+        k = AB_K_MAX;
 
-    for(t1 = 0; t1 < NCOMP; t1++)
-    {
-        aN2[t1] /= f;
-        bN2[t1] *= f;
-    }
+    aN2 = abN2[k - AB_K_MIN][0];
+    bN2 = abN2[k - AB_K_MIN][1];
+    nft_valid = 0;
 
     if(!showmode)
         return;
 
     // A- und B-Werte anzeigen 
-    lcd_putstring(0, 0, "a- und b-Werte:");
+    lcd_putstring_P(0, 0, PSTR("a- und b-Werte:"));
     wait_ms(1000);
     lcd_cls();
 
@@ -496,10 +1376,10 @@ void set_ab_values(int k, unsigned char showmode)
     {
         lcd_putchar(0, 0, 'a');
         lcd_putnumber(0, 1, t1, -1, -1, 'l', 1);
-        lcd_putnumber(0, 4, aN2[t1 + 1] * 10000, 5, 4, 'l', 1);
+        lcd_putnumber(0, 4, PFLOAT(A_N2(t1 + 1)) * 10000, 5, 4, 'l', 1);
         lcd_putchar(1, 0, 'b');
         lcd_putnumber(1, 1, t1, -1, -1, 'l', 1);
-        lcd_putnumber(1, 4, bN2[t1 + 1] * 10000, 5, 4, 'l', 1);
+        lcd_putnumber(1, 4, PFLOAT(B_N2(t1 + 1)) * 10000, 5, 4, 'l', 1);
         wait_ms(1000);
         lcd_cls();
     }
@@ -509,15 +1389,19 @@ void set_ab_values(int k, unsigned char showmode)
 // Drucksensor auslesen 
 void get_dsensor()
 {
-    unsigned char xpos;
+    unsigned char xpos, asc;
+    long x, v;
 
-    adc_mode = 0;
+    adc_wait(ADC_DEPTH);
+    cli();
+    x = dflt_x;
+    v = dflt_v;
+    asc = dflt_asc;
+    sei();
 
-    // AD-Wandler 
-    ADMUX = 64 + 128;     // Interne Referenz auf 2,56V und Kanal 0 aktivieren PA0 PIN 40 
-    wait_ms(ADWAITSTATE);
-    ADCSRA = 206;   // AD-Wandler abfragen 
-    wait_ms(ADWAITSTATE);
+    // 1/4 dm * 256 -> dm, 1/4 dm pro Ueberlauf * 256 -> dm/min 
+    depth = x < 0 ? 0 : (x + 512) >> 10;
+    depth_rate = v * (60 * TICKS_PER_S / 4) / 256;
 
    if(depth > 999)
     {
@@ -531,48 +1415,102 @@ void get_dsensor()
     }
 
 
+    // Zeile 1 jede Sekunde neu (Warnungen), Zeile 2 bleibt bis zum neuen 
+    // Dekoplan stehen                                                     
+    lcd_linecls(0, 15);
     lcd_printdiveinfo(depth, maxdepth, diveseconds * 0.0166666667);
 
+    // Aufstieg zu schnell: led(4) (LED 3 an PC4) an, solange die          
+    // Geschwindigkeit ASCENT_TICKS Werte in Folge ueber ASCENT_MAX liegt 
+    ascent_fast = dphase && asc >= ASCENT_TICKS;
+    led(4, ascent_fast);
+
+    // Die Warnungen teilen sich den Platz der max. Tiefe, die            
+    // uebertauchte Dekostufe hat Vorrang vor "LANGSAM"                  
     if(depth < (deepest_decostep - 1) * 10)
     {
         led(3, 1);
-        lcd_putstring(0, 6, "!  ");
+        lcd_putstring_P(0, 6, PSTR("!  "));
         xpos = lcd_putnumber(0, 7, deepest_decostep, -1, -1, 'l', 1) + 7;
-        lcd_putstring(0, xpos, "m! ");
+        lcd_putstring_P(0, xpos, PSTR("m! "));
         wait_ms(50);
         led(3, 0);
 
         if(!decostep_skipped) // Flag fuer Profilaufzeichnung setzen 
         {
-            eeprom_store_byte(223);
+            prof_store_marker(223);
             decostep_skipped = 1;
         }
     }
+    else if(ascent_fast)
+        lcd_putstring_P(0, 5, PSTR("LANGSAM"));
 }
 
-// Temperatursensor auslesen 
-void get_tsensor()
+// Neuen Tiefenwert (4facher ADC-Wert) in den Filter geben (nur in SIG_ADC) 
+void depth_filter(unsigned int z)
 {
+    long r;
+
+    if(!dflt_init)
+    {
+        dflt_x = (long) z << 8;
+        dflt_v = 0;
+        dflt_init = 1;
+        return;
+    }
+
+    dflt_x += dflt_v;
+    r = ((long) z << 8) - dflt_x;
+    dflt_x += r >> DFLT_ALPHA;
+    dflt_v += r >> DFLT_BETA;
 
-    adc_mode = 1;
+    if(-dflt_v <= DFLT_V_ASCENT)
+        dflt_asc = 0;
+    else if(dflt_asc < ASCENT_TICKS)
+        dflt_asc++;
+}
 
-    // AD-Wandler 
-    ADMUX = 64 + 128 + 1; // Interne Referenz 2,56V und Kanal 1 aktivieren PA PIN 39 
-    wait_ms(ADWAITSTATE);
-    ADCSRA = 206;   // AD-Wandler abfragen 
-    wait_ms(ADWAITSTATE);
+// Temperatursensor auslesen 
+void get_tsensor()
+{
+    adc_wait(ADC_TEMP);
+    temp = (adc_result[ADC_TEMP] * 0.25 - 394.6344) / 2.9656;
 }
 
 // Akkuspannung messen
 void get_vsensor()
 {
-    adc_mode = 2;
+    adc_wait(ADC_VOLT);
+    accu_voltage = adc_result[ADC_VOLT] * 0.25 / 69;
+}
+
+// Messreihe ueber die Kanaele 0 bis last starten (SIG_OVERFLOW2, bei 
+// Programmstart adc_wait()), die Ergebnisse der uebrigen bleiben     
+void adc_burst(unsigned char last)
+{
+    adc_ch = 0;
+    adc_last = last;
+    adc_cnt = -ADC_SETTLE;
+    adc_sum = 0;
+    adc_done &= ~((2 << last) - 1);
+    adc_busy = 1;
+    adc_start(0);
+}
 
-    // AD-Wandler 
-    ADMUX = 64 + 128 + 2; // Interne Referenz und Kanal 2 aktivieren PA PIN 38 
-    wait_ms(ADWAITSTATE);
-    ADCSRA = 206;   // AD-Wandler abfragen 
-    wait_ms(ADWAITSTATE);
+// Warten, bis der Kanal in der laufenden Messreihe fertig ist. Nach dem 
+// Ende der Messreihe gilt ihr Ergebnis bis zur naechsten.              
+void adc_wait(unsigned char ch)
+{
+    for(;;)
+    {
+        cli();
+        if(adc_done & (1 << ch))
+            break;
+        if(!adc_busy)
+            adc_burst(ADC_CHANNELS - 1);
+        adc_sleep();   // gibt die Interrupts frei 
+    }
+    sei();
 }
 
 
@@ -587,11 +1525,11 @@ int calc_ppo2(char display_warning)
     {
         if(display_warning)
         {
-            lcd_putstring(1, 10, " ppO2!");
+            lcd_putstring_P(1, 10, PSTR(" ppO2!"));
       }
         if(!ppo2_exceeded)
         {
-            eeprom_store_byte(224);
+            prof_store_marker(224);
             ppo2_exceeded = 1;
         }
     }
@@ -601,42 +1539,28 @@ int calc_ppo2(char display_warning)
 }
 
 
-// ZNS- und OTU-Werte berechnen (Aufruf 1 x pro Minute) 
+// ZNS- und OTU-Werte berechnen (Aufruf alle 10 s mit der Saettigung) 
 void calc_cns_otu()
 {
-    // ZNS-Tabelle 
-    unsigned int f_day[11] =  {720, 570, 450, 360, 300, 270, 240, 210, 180, 165, 150};
-    unsigned int f_dive[11] = {720, 570, 450, 360, 300, 240, 210, 180, 150, 120, 45};
-
-    // Index des Tabellenwertes zu geg. ppO2 
-    int ndx = calc_ppo2(0) - 6;
+    int ppo2;
+    unsigned char ndx;
 
-    // ppO2-Rechnungen 
-    float otu_ppO2 = calc_ppo2(0) * .1 - .5;
-    float cns_ppO2 = calc_ppo2(0) * .1;
-
-    // ZNS in Oberflaechenmodus t1/2 = 90 min. 
+    // ZNS in Oberflaechenmodus t1/2 = 90 min. (2^(-1/540) je 10 s) 
     if(!dphase)
     {
-        cns_day *= 0.992327946262943;
+        cns_day *= 0.99871721757974;
         return;
     }
 
-    if(ndx >= 0 && ndx <= 10) // Normaler ppO2 => Berechnung der Dosis auf Basis der Tabelle
-    {
-        cns_day += 100 * exp(-1 * log(f_day[ndx]));
-        cns_dive += 100 * exp(-1 * log(f_dive[ndx]));
-    }
-
-    if(ndx > 10) // Sehr hoher ppO2 => Berechnung der Dosis auf funktionaler Basis 
-    {
-        cns_day +=   100 * exp(-1 * log((cns_ppO2 * 432) - (cns_ppO2 - .6) * 120));
-        cns_dive += 100 * exp(-1 * log((cns_ppO2 * 432) - (cns_ppO2 - .6) * 120));
-    }
+    // ppO2 [0.01 bar], Tiefe [dm] entspricht 0.01 bar 
+    ppo2 = (depth * 0.01 + airp) * (1 - figN2[curgas]) * 100 + 0.5;
+    if(ppo2 <= PPO2_TAB_MIN)
+        return;
+    ndx = (ppo2 < PPO2_TAB_MAX ? ppo2 : PPO2_TAB_MAX) - PPO2_TAB_MIN;
 
-    // OTU 
-    if(otu_ppO2 > 0)
-        otu += exp(0.83 * log(otu_ppO2 * 2));
+    cns_day += pgm_read_word(&cns_day_tab[ndx]) * (1.0 / 65536);
+    cns_dive += pgm_read_word(&cns_dive_tab[ndx]) * (1.0 / 65536);
+    otu += pgm_read_word(&otu_tab[ndx]) * (1.0 / 65536);
 }
 
 //***************
@@ -646,9 +1570,40 @@ void calc_cns_otu()
 //************************************
 // Funktionen und Prozeduren fuer LCD 
 //************************************
+#ifndef HOST_SIM
+#if LCD_TIMING == LCD_TIMING_BUSY
+// Warten, bis das Display den letzten Befehl ausgefuehrt hat 
+// (Busy-Flag auf DB7, im 4-Bit-Modus zwei Nibbles lesen)      
+void lcd_wait_busy(void)
+{
+    unsigned char busy;
+
+    DDRD &= 0x0F;           // DB4-DB7 als Eingang 
+    set_rs(0);
+    PORTC |= _BV(PC5);      // R/W=1 => lesen 
+    do
+    {
+        set_e(1);
+        _delay_us(1);
+        busy = PIND & 0x80; // Hi-Nibble mit Busy-Flag 
+        set_e(0);
+        set_e(1);
+        _delay_us(1);       // Lo-Nibble (Adresszaehler) verwerfen 
+        set_e(0);
+    }while(busy);
+    PORTC &= ~_BV(PC5);
+    DDRD |= 0xF0;
+}
+#endif
+
 // Ein Byte (Befehl bzw. Zeichen) zum Display senden 
+// waitcycles > 1 nur bei der Initialisierung       
 void lcd_write(char lcdmode, unsigned char value, int waitcycles)
 {
+#if LCD_TIMING == LCD_TIMING_BUSY
+    if(waitcycles == 1)
+        lcd_wait_busy();
+#endif
     set_e(0);
 
     if(!lcdmode)
@@ -656,7 +1611,12 @@ void lcd_write(char lcdmode, unsigned char value, int waitcycles)
     else
         set_rs(1);    // RS=1 => Zeichen 
 
-    wait_ms(waitcycles * 2);
+#if LCD_TIMING == LCD_TIMING_MS
+    delay_ms(waitcycles * 2);
+#else
+    if(waitcycles > 1)
+        delay_ms(waitcycles * 2);
+#endif
 
     set_e(1);
     PORTD = value & 0xF0;           // Hi byte 
@@ -665,19 +1625,51 @@ void lcd_write(char lcdmode, unsigned char value, int waitcycles)
     PORTD = (value & 0x0F) * 0x10;  // Lo byte 
     set_e(0);
 
+#if LCD_TIMING == LCD_TIMING_US
+    _delay_us(LCD_EXEC_US);
+#endif
 }
+#endif
 
-// Ein Zeichen (Char) zum Display senden, dieses in 
-// Zeile row und Spalte col positionieren           
+// Ein Zeichen (Char) in Zeile row und Spalte col setzen 
+// (Zeichen ausserhalb der Anzeige entfallen)           
 void lcd_putchar(int row, int col, unsigned char ch)
 {
-    lcd_write(LCD_INST, col + 128 + row * 0x40, 1);
-    lcd_write(LCD_DATA, ch, 1);
+    if(row >= 0 && row < LCD_ROWS && col >= 0 && col < LCD_COLS)
+        lcd_buf[row][col] = ch;
+}
+
+// Geaenderte Zeichen zum Display senden. Die DDRAM-Adresse zaehlt nach 
+// jedem Zeichen weiter, sie wird nur vor Luecken neu gesetzt.          
+void lcd_flush(void)
+{
+    unsigned char row, col, adr = 0xFF;
+    char ch;
+
+    for(row = 0; row < LCD_ROWS; row++)
+    {
+        for(col = 0; col < LCD_COLS; col++)
+        {
+            // Nur einmal lesen, SIG_UART_RECV kann die Zelle aendern 
+            ch = lcd_buf[row][col];
+            if(ch == lcd_disp[row][col])
+                continue;
+
+            if(adr != col + row * 0x40)
+            {
+                adr = col + row * 0x40;
+                lcd_write(LCD_INST, adr + 128, 1);
+            }
+            lcd_write(LCD_DATA, ch, 1);
+            lcd_disp[row][col] = ch;
+            adr++;
+        }
+    }
 }
 
 
-// Eine Zeichenkette direkt in das LCD schreiben 
-// Parameter: Startposition, Zeile und Pointer   
+// Eine Zeichenkette in das LCD schreiben      
+// Parameter: Startposition, Zeile und Pointer 
 void lcd_putstring(int row, int col, char *s)
 {
     unsigned char t1;
@@ -687,10 +1679,22 @@ void lcd_putstring(int row, int col, char *s)
 }
 
 
-// Display loeschen 
+// Eine Zeichenkette aus dem Flash (PROGMEM, PSTR()) in das LCD schreiben 
+void lcd_putstring_P(int row, int col, const char *s)
+{
+    unsigned char t1;
+    char c;
+
+    for(t1 = col; (c = pgm_read_byte(s)); t1++, s++)
+        lcd_putchar(row, t1, c);
+}
+
+
+// Display loeschen (nur der Puffer, lcd_flush() sendet Leerzeichen 
+// an die Stellen, die danach nicht wieder beschrieben werden)     
 void lcd_cls(void)
 {
-    lcd_write(LCD_INST, 1, 5);
+    memset(lcd_buf, ' ', sizeof(lcd_buf));
 }
 
 
@@ -703,6 +1707,7 @@ void lcd_linecls(int displine, int chars)
         lcd_putchar(displine, t1, 32);
 }
 
+#ifndef HOST_SIM
 // E setzen 
 void set_e(char status)  // PORT C0 = Pin 6 am LCD 
 {
@@ -732,6 +1737,7 @@ void set_rs(char status) // PORT C1 = Pin 4 am LCD
       PORTC &= ~_BV(PC1);
    }
 }
+#endif
 
 // LCD-Display initialisieren 
 void lcd_init(void)
@@ -747,10 +1753,12 @@ void lcd_init(void)
     // Display on, Cursor off, Blink off 
     lcd_write(LCD_INST, 12, 5);
 
+    lcd_write(LCD_INST, 1, 5);
+    memset(lcd_disp, ' ', sizeof(lcd_disp));
     lcd_cls();
 
-    // Entrymode !cursoincrease + !displayshifted 
-    lcd_write(LCD_INST, 4, 5);
+    // Entrymode cursorincrease + !displayshifted (fuer lcd_flush()) 
+    lcd_write(LCD_INST, 6, 5);
 }
 
 
@@ -848,7 +1856,7 @@ void lcd_printdiveinfo(int cdepth, int mdepth, int divetime)
     lcd_putchar(0, 4, 'm');
 
     lcd_putnumber(0, 6, mdepth, 3, 1, 'l', 0);
-    lcd_putstring(0, 10, "m");
+    lcd_putstring_P(0, 10, PSTR("m"));
 
     lcd_putnumber(0, 14, divetime, -1, -1, 'r', 1); // Tauchzeit rechtsbuendig 1. Zeile 
     lcd_putchar(0, 15, 39);
@@ -858,7 +1866,7 @@ void lcd_printdiveinfo(int cdepth, int mdepth, int divetime)
 // Temperatur anzeigen 
 void showtemp()
 {
-    lcd_putstring(1, 12, "   ");
+    lcd_putstring_P(1, 12, PSTR("   "));
     lcd_putnumber(1, 14, temp * 10, 3, 1, 'r', 0); // ORIG!
    //lcd_putnumber(1, 14, temp, -1, -1, 'r', 0); //TEST zur Ausgabe des ADC-Wertes!
 
@@ -868,7 +1876,7 @@ void showtemp()
 void show_accu_voltage()
 {
     get_vsensor();
-    lcd_putstring(1, 0, "BAT:");
+    lcd_putstring_P(1, 0, PSTR("BAT:"));
     lcd_putchar(1, 5 + lcd_putnumber(1, 5, accu_voltage * 10, 2, 1, 'l', 1), 'V');
    //lcd_putnumber(1, 5, accu_voltage, -1, -1, 'l', 1); //TEST
 }
@@ -881,10 +1889,10 @@ void show_gas(int gasnum)
     lcd_cls();
     if(gasnum < MAXGASES)
     {
-        lcd_putstring(0, 0, "Gas");
+        lcd_putstring_P(0, 0, PSTR("Gas"));
         lcd_putnumber(0, 4, gasnum + 1, -1, -1, 'l', 1);
 
-        lcd_putstring(1, 0, "N2:");
+        lcd_putstring_P(1, 0, PSTR("N2:"));
         xpos = lcd_putnumber(1, 4, figN2[gasnum] * 100, -1, -1, 'l', 1) + 4;
         lcd_putchar(1, xpos, '%');
     }
@@ -918,10 +1926,10 @@ void set_curgas()
 
     if(curgas != lcurgas)
     {
-        lcd_putstring(0, 0, "Wechsel zu Gas");
+        lcd_putstring_P(0, 0, PSTR("Wechsel zu Gas"));
         lcd_putnumber(0, 15, lcurgas + 1, -1, -1, 'l', 1);
         curgas = lcurgas;
-        eeprom_store_byte(226);
+        prof_store_marker(226);
         eeprom_store_byte(curgas);
     }
 
@@ -950,23 +1958,25 @@ void calc_airp_divesite(char show_mode)
     {
         wait_ms(INITWAIT);
         lcd_cls();
-        lcd_putstring(0, 0, "Luftdruck TP");
+        lcd_putstring_P(0, 0, PSTR("Luftdruck TP"));
         xpos = lcd_putnumber(1, 0, airp0_tmp, -1, -1, 'l', 1) + 1;
-        lcd_putstring(1, xpos, "mbar");
+        lcd_putstring_P(1, xpos, PSTR("mbar"));
     }
 
     airp = airp0_tmp * 0.001;
+    airp_p = PFIX(airp);
+    nft_valid = 0;
 }
 // Ende LCD-Teil 
 
 //*******
 // USART 
 //*******
+#ifndef HOST_SIM
 void usart_init()
 {
     // 2.4 kBaud 
-    UBRRL = 220; // Originaler Wert = 207 fuer 2.4k 215 
-    UBRRH = 0;
+    usart_baud(pgm_read_word(&baud_ubrr[0]));
 
     // RX Interrupt, RX und TX einschalten 
     UCSRB = (1<<RXCIE)|(1<<RXEN)|(1<<TXEN);
@@ -977,35 +1987,133 @@ void usart_init()
     rx_buf_cnt = 0;
 }
 
-void usart_putc(char tx_char)
+// Baudrate einstellen, immer mit doppelter Geschwindigkeit (U2X). 
+// Grundrate: Originaler Wert ohne U2X = 207 fuer 2.4k 215, abgeglichen 220 
+void usart_baud(unsigned int ubrr)
 {
-    while(!(UCSRA & (1<<UDRE)));
+    UCSRA = (1<<U2X);
+    UBRRH = ubrr >> 8;
+    UBRRL = ubrr & 0xFF;
+}
 
+// Zeichen senden (nur in SIG_UART_DATA, UDR ist dort leer), TXC loeschen 
+void usart_write(char tx_char)
+{
+    UCSRA = (1<<U2X)|(1<<TXC);
     UDR = tx_char;
 }
 
-SIGNAL(SIG_UART_RECV)
+// Letztes Zeichen vollstaendig gesendet? 
+char usart_tx_done(void)
 {
-    unsigned char rx_char = UDR, inputlen = 2;
-    unsigned int t1, byte_adr, x = 0;;
+    return UCSRA & (1<<TXC);
+}
 
-    if(rx_buf_cnt < RX_BUF_SIZE)
-    {
-        rx_buf[rx_buf_cnt] = rx_char;
+// UDRE-Interrupt ein- und ausschalten 
+void usart_tx_on(void)
+{
+    UCSRB |= (1<<UDRIE);
+}
 
-        switch(rx_buf[0])
-        {
-          case 100:
-            inputlen = 2; // 1 Byte lesen 
-            rx_buf_cnt++;
-            break;
+void usart_tx_off(void)
+{
+    UCSRB &= ~(1<<UDRIE);
+}
+
+// Empfangenes Zeichen abholen (nur in SIG_UART_RECV) 
+char usart_getc(void)
+{
+    return UDR;
+}
+
+// RX, TX und RX-Interrupt abschalten 
+void usart_off(void)
+{
+    UCSRB = 0;
+}
+#endif
+
+// Zeichen in den Sendepuffer schreiben (im Hauptprogramm nur mit 
+// gesperrten Interrupts, da auch SIG_UART_RECV sendet)           
+void usart_putc(char tx_char)
+{
+    unsigned char head = (tx_head + 1) & TX_BUF_MASK;
+    unsigned char fill;
+
+    if(head == tx_tail)
+    {
+        tx_dropped++;
+        return;
+    }
+
+    tx_buf[tx_head] = tx_char;
+    tx_head = head;
+
+    fill = (head - tx_tail) & TX_BUF_MASK;
+    if(fill > tx_buf_max)
+        tx_buf_max = fill;
+
+    usart_tx_on();
+}
+
+// UDR ist leer: naechstes Zeichen aus dem Sendepuffer 
+SIGNAL(SIG_UART_DATA)
+{
+    if(tx_tail == tx_head)
+    {
+        usart_tx_off();
+        return;
+    }
+
+    usart_write(tx_buf[tx_tail]);
+    tx_tail = (tx_tail + 1) & TX_BUF_MASK;
+}
+
+SIGNAL(SIG_UART_RECV)
+{
+    unsigned char rx_char = usart_getc(), inputlen = 2;
+    unsigned int t1, byte_adr, len, x = 0;;
+
+    if(rx_buf_cnt < RX_BUF_SIZE)
+    {
+        rx_buf[rx_buf_cnt] = rx_char;
+
+        switch(rx_buf[0])
+        {
+          case 100:
+            inputlen = 2; // 1 Byte lesen 
+            rx_buf_cnt++;
+            break;
 
           case 101:
             inputlen = 4; // 1 Byte schreiben 
             rx_buf_cnt++;
             break;
 
+          case 102:
+            inputlen = 4; // Bereich lesen 
+            rx_buf_cnt++;
+            break;
+
+          case 103:
+            inputlen = 2; // Bereich fortsetzen 
+            rx_buf_cnt++;
+            break;
+
+          case 104:
+          case 105:
+            inputlen = 2; // Baudrate umschalten / bestaetigen 
+            rx_buf_cnt++;
+            break;
+
+          case 106:
+            inputlen = 0; // Stackreserve lesen 
+            rx_buf_cnt++;
+            break;
+
           default:   clear_rx_buf();
+                     if(baud_test)  // falsche Baudrate 
+                         baud_next = 0;
         }
     }
     else
@@ -1017,9 +2125,18 @@ SIGNAL(SIG_UART_RECV)
         for(t1 = 0; t1 < rx_buf_cnt; t1++)
             usart_putc(rx_buf[t1]);
 
-        byte_adr = rx_buf[1] + rx_buf[2] * 256;
+        byte_adr = (unsigned char) rx_buf[1] + (unsigned char) rx_buf[2] * 256;
 
-        if(byte_adr <= MAX_EEPROM_ADR)
+        if(rx_buf[0] == 104 || rx_buf[0] == 105)
+            usart_baud_cmd();
+        else if(rx_buf[0] == 106)
+        {
+            len = stack_unused();
+            usart_putc(len & 0xFF);
+            usart_putc(len >> 8);
+            usart_putc(make_crc(1, (len & 0xFF) ^ (len >> 8)));
+        }
+        else if(byte_adr <= MAX_EEPROM_ADR)
         {
             lcd_putnumber(1, 8, byte_adr, 4, -1, 'l', 1);
 
@@ -1027,10 +2144,10 @@ SIGNAL(SIG_UART_RECV)
             switch(rx_buf[0])
             {
               case 100:  // 1 Byte lesen 
-                usart_putc(eeprom_read_byte((uint8_t*)byte_adr));               // Byte senden 
-                usart_putc(make_crc(3, eeprom_read_byte((uint8_t*)byte_adr)));  // CRC anhaengen 
-                lcd_putstring(1, 0, "Tx  ");
-                lcd_putnumber(1, 13, eeprom_read_byte((uint8_t*)byte_adr), 3, -1, 'l', 1);
+                usart_putc(ee_read(byte_adr));               // Byte senden 
+                usart_putc(make_crc(3, ee_read(byte_adr)));  // CRC anhaengen 
+                lcd_putstring_P(1, 0, PSTR("Tx  "));
+                lcd_putnumber(1, 13, ee_read(byte_adr), 3, -1, 'l', 1);
                 break;
 
               case 101:  // 1 Byte schreiben 
@@ -1039,23 +2156,153 @@ SIGNAL(SIG_UART_RECV)
 
             if(x == rx_buf[4])   // CRC ist OK 
             {
-                cli();
-                    while(!eeprom_is_ready());
-                    eeprom_write_byte((uint8_t*)(rx_buf[1] + rx_buf[2] * 256), rx_buf[3]);
-                    sei();
-                    lcd_putstring(1, 0, "Rx  ");
+                    ee_put(byte_adr, rx_buf[3]);
+                    if(byte_adr < CFG_ADR + sizeof(cfg))  // Abbild nachfuehren 
+                        ((unsigned char*) &cfg)[byte_adr - CFG_ADR] = rx_buf[3];
+                    lcd_putstring_P(1, 0, PSTR("Rx  "));
                     lcd_putnumber(1, 13, rx_buf[3], 3, -1, 'l', 1);
             }
                 else
                 {
-                lcd_putstring(1, 0, "CRC!");
+                lcd_putstring_P(1, 0, PSTR("CRC!"));
             }
+                break;
+
+              case 102:  // Bereich lesen, senden in usart_send_block() 
+                len = (unsigned char) rx_buf[3] + (unsigned char) rx_buf[4] * 256;
+                if(len > MAX_EEPROM_ADR + 1 - byte_adr)
+                    len = MAX_EEPROM_ADR + 1 - byte_adr;
+                blk_end = byte_adr + len;
+                blk_adr = byte_adr;
+                blk_run = 1;
+                lcd_putstring_P(1, 0, PSTR("Blk "));
+                break;
+
+              case 103:  // Bereich ab Adresse fortsetzen 
+                if(byte_adr <= blk_end)
+                {
+                    blk_adr = byte_adr;
+                    blk_run = 1;
+                    lcd_putstring_P(1, 0, PSTR("Blk "));
+                }
             }
         }
         clear_rx_buf();
     }
 }
 
+// Naechsten Block der Blockuebertragung in den Sendepuffer schreiben, 
+// sobald dort Platz ist (Hauptprogramm)                               
+void usart_send_block(void)
+{
+    unsigned char block[BLK_SIZE + 5];
+    unsigned int adr, end;
+    unsigned char t1, n;
+    uint16_t crc = 0xFFFF;
+    char run, sent = 0;
+
+    cli();
+    adr = blk_adr;
+    end = blk_end;
+    run = blk_run;
+    sei();
+
+    if(!run)
+        return;
+
+    n = (end - adr > BLK_SIZE) ? BLK_SIZE : end - adr;
+
+    block[0] = adr & 0xFF;
+    block[1] = adr >> 8;
+    block[2] = n;
+    for(t1 = 0; t1 < n; t1++)
+        block[t1 + 3] = ee_read(adr + t1);
+    for(t1 = 0; t1 < n + 3; t1++)
+        crc = make_crc16(crc, block[t1]);
+    block[n + 3] = crc >> 8;
+    block[n + 4] = crc & 0xFF;
+
+    // Ganzen Block schreiben, ohne dass SIG_UART_RECV dazwischen sendet, 
+    // und nur, wenn der PC inzwischen keinen neuen Bereich angefordert hat 
+    cli();
+    if(blk_adr == adr && ((tx_tail - tx_head - 1) & TX_BUF_MASK) >= n + 5)
+    {
+        for(t1 = 0; t1 < n + 5; t1++)
+            usart_putc(block[t1]);
+        blk_adr = adr + n;
+        if(!n)
+            blk_run = 0;
+        sent = 1;
+    }
+    sei();
+
+    if(sent)
+        lcd_putnumber(1, 8, adr, 4, -1, 'l', 1);
+}
+
+// Befehle 104/105 auswerten (in SIG_UART_RECV) 
+void usart_baud_cmd(void)
+{
+    unsigned char rate = rx_buf[1];
+
+    if((rx_buf[0] ^ rx_buf[1]) != rx_buf[2] || rate >= BAUD_RATES)
+    {
+        lcd_putstring_P(1, 0, PSTR("CRC!"));
+        if(baud_test)
+            baud_next = 0;
+        return;
+    }
+
+    if(rx_buf[0] == 104)
+        baud_next = rate;
+    else if(baud_test && rate == baud_cur)
+        baud_test = 0;
+    else if(baud_test)
+        baud_next = 0;
+
+    lcd_putstring_P(1, 0, PSTR("Bd  "));
+    lcd_putnumber(1, 13, rate, 3, -1, 'l', 1);
+}
+
+// Angeforderte Baudrate einstellen, sobald die Quittung vollstaendig 
+// gesendet ist, und ohne Bestaetigung zur Grundrate zurueckkehren     
+// (Hauptprogramm)                                                     
+void usart_baud_task(void)
+{
+    if(baud_next < 0)
+    {
+        if(baud_test && runseconds > baud_time + BAUD_TIMEOUT)
+            baud_next = 0;
+        return;
+    }
+
+    if(tx_head != tx_tail || !usart_tx_done())
+        return;
+
+    usart_baud(pgm_read_word(&baud_ubrr[(unsigned char) baud_next]));
+    baud_cur = baud_next;
+    baud_test = (baud_cur != 0);
+    baud_time = runseconds;
+    baud_next = -1;
+}
+
+// CRC-16 (CCITT) um ein Byte weiterrechnen 
+uint16_t make_crc16(uint16_t crc, unsigned char c)
+{
+    unsigned char t1;
+
+    crc ^= (uint16_t) c << 8;
+    for(t1 = 0; t1 < 8; t1++)
+    {
+        if(crc & 0x8000)
+            crc = (crc << 1) ^ 0x1021;
+        else
+            crc <<= 1;
+    }
+
+    return crc;
+}
+
 // CRC-Pruefsumme berechnen 
 char make_crc(int buflen, int addchar)
 {
@@ -1086,19 +2333,34 @@ void sbtc2pc()
     lcd_cls();
 
     // Datenuebertragung zum PC starten? 
-    lcd_putstring(0, 0, "SBTC <-> PC?");
-    lcd_putstring(1, 0, "(j/n)");
+    lcd_putstring_P(0, 0, PSTR("SBTC <-> PC?"));
+    lcd_putstring_P(1, 0, PSTR("(j/n)"));
     do
     {
         if(get_keys() == 3)
         {
             usart_init();
             lcd_cls();
-            lcd_putstring(0, 0, "Modus");
-            lcd_putstring(0, 8, "ADRS VAL");
+            lcd_putstring_P(0, 0, PSTR("Modus"));
+            lcd_putstring_P(0, 8, PSTR("ADRS VAL"));
 
-            while(get_keys() != 2);
-            UCSRB = 0;
+            blk_run = 0;
+            baud_cur = baud_test = 0;
+            baud_next = -1;
+            while(get_keys() != 2)
+            {
+                usart_baud_task();
+                usart_send_block();
+            }
+
+            // Sendepuffer leeren lassen 
+            blk_run = 0;
+            while(tx_head != tx_tail)
+                wait_ms(2);
+            usart_off();
+
+            // Vom PC geschriebene Bytes sichern 
+            ee_flush();
             return;
         }
     }while(get_keys() != 2);
@@ -1107,103 +2369,124 @@ void sbtc2pc()
 
 }
 
+// Messpunkt des Profils anzeigen, Rueckgabe 1 bei Abbruch (Taste 2) 
+char prof_show(unsigned int sample, int xdepth)
+{
+    unsigned char xpos;
+
+    lcd_linecls(1, 15);
+
+    xpos = lcd_putnumber(1, 0, sample * PROF_INTERVAL / 60, -1, -1, 'l', 1) + 1;
+    lcd_putstring_P(1, xpos, PSTR("min."));
+
+    xpos = lcd_putnumber(1, 8, xdepth, xdepth < 10 ? 2 : -1, 1, 'l', 1) + 9;
+    lcd_putchar(1, xpos, 'm');
+    wait_ms(500);
+
+    return get_keys() == 2;
+}
+
 void display_profile()
 {
-    unsigned int t1;
-   int startbyte = 55, endbyte;
-   int xdepth = 0;
-    unsigned char xpos, ok, p_cnt = 1;
+    unsigned int t1, len, adr, startbyte, sample;
+    unsigned int dive_nr = 0xFFFF;
+    int xdepth, slot, dd[3];
+    unsigned char b, fmt, stop, n, k;
 
     while(get_keys());
     lcd_cls();
 
-    lcd_putstring(0, 0, "TG-Profil an-");
-    lcd_putstring(1, 0, "zeigen? (j/n)");
+    lcd_putstring_P(0, 0, PSTR("TG-Profil an-"));
+    lcd_putstring_P(1, 0, PSTR("zeigen? (j/n)"));
 
     do
     {
         if(get_keys() == 3)
         {
-          cli();
-         while(1)
+         // Profile vom neuesten zum aeltesten TG ueber das Verzeichnis 
+         while((slot = dir_find(dive_nr)) >= 0)
          {
+            dive_nr = dir_read(slot, DIR_NUM);
+            startbyte = prof_adr(dir_read(slot, DIR_POS_START) + 5);  // 229 
+            len = prof_dist(startbyte, dir_read(slot, DIR_POS_END));
+            fmt = ee_read(prof_adr(startbyte + EEPROM_PROF_SIZE - 1));
+
             lcd_cls();
+            lcd_putstring_P(0, 0, PSTR("Profil"));
+            lcd_putnumber(0, 7, dive_nr, -1, -1, 'l', 1);
+            wait_ms(1000);
 
-            // Startbyte finden 
-            t1 = startbyte;
-            endbyte = 0;
-            ok = 0;
-            while(t1 < MAX_EEPROM_ADR && !ok)
+            lcd_cls();
+            lcd_putstring_P(0, 0, PSTR("Zeit"));
+            lcd_putstring_P(0, 8, PSTR("Tiefe"));
+            xdepth = 0;
+            sample = 0;
+            for(t1 = 1; t1 < len; t1++)
             {
-               if(eeprom_read_byte((uint8_t*)t1) == 229)
-               {
-                  startbyte = t1;
-                  ok = 1;
-               }
-               else
-                  t1++;
-            }
+               adr = prof_adr(startbyte + t1);
+               b = ee_read(adr);
+               stop = 0;
 
-            t1 = startbyte + 1;
-            ok = 0;
-            while(t1 < MAX_EEPROM_ADR && !ok)
-            {
-               if(eeprom_read_byte((uint8_t*)t1) == 230)
+               if(b == 226)                       // Gaswechsel, Nr. des Gases folgt 
+                  t1++;
+               else if(!(fmt & PROF_FMT_DELTA))   // altes Format in [m] 
                {
-                  endbyte = t1;
-                  ok = 1;
+                  if(b < 99)
+                     stop = prof_show(++sample, b * 10);
                }
-               else
-                  t1++;
-            }
-
-            if(endbyte)
-            {
-               lcd_cls();
-               lcd_putstring(0, 0, "Profil");
-               lcd_putnumber(0, 7, p_cnt++, -1, -1, 'l', 1);
-               wait_ms(1000);
-
-               lcd_cls();
-               lcd_putstring(0, 0, "Zeit");
-               lcd_putstring(0, 8, "Tiefe");
-               for(t1 = startbyte + 1; t1 < endbyte; t1++)
+               else if(b < PROF_PAIR + 49)        // 1 bis 3 Messpunkte 
                {
-                  xdepth = eeprom_read_byte((uint8_t*)t1);
-                  if(xdepth < 99)
+                  if(b < PROF_SINGLE - 22)
                   {
-                     lcd_linecls(1, 15);
-
-                     xpos = lcd_putnumber(1, 0, (int)((t1 - startbyte) * 0.3333333), -1, -1, 'l', 1) + 1;
-                     lcd_putstring(1, xpos, "min.");
-
-
-                     xpos = lcd_putnumber(1, 8, xdepth, -1, -1, 'l', 1) + 9;
-                     lcd_putchar(1, xpos, 'm');
-                     wait_ms(500);
+                     dd[0] = b / 25 - 2;
+                     dd[1] = b / 5 % 5 - 2;
+                     dd[2] = b % 5 - 2;
+                     n = 3;
+                  }
+                  else if(b < PROF_PAIR)
+                  {
+                     dd[0] = b - PROF_SINGLE;
+                     n = 1;
+                  }
+                  else
+                  {
+                     dd[0] = (b - PROF_PAIR) / 7 - 3;
+                     dd[1] = (b - PROF_PAIR) % 7 - 3;
+                     n = 2;
+                  }
 
-                     if(get_keys() == 2)
-                     {
-                        lcd_cls();
-                        sei();
-                        return;
-                     }
+                  for(k = 0; k < n && !stop; k++)
+                  {
+                     xdepth += dd[k];
+                     stop = prof_show(++sample, xdepth);
                   }
                }
+               else if(b == PROF_ABS)             // absolute Tiefe 
+               {
+                  xdepth = ee_read(prof_adr(adr + 1)) * 200 + ee_read(prof_adr(adr + 2));
+                  t1 += 2;
+                  stop = prof_show(++sample, xdepth);
+               }
+               else if(b > PROF_ABS)              // ohne Aenderung, nur letzten zeigen 
+               {
+                  sample += b - PROF_RUN;
+                  stop = prof_show(sample, xdepth);
+               }
+
+               if(stop)
+               {
+                  lcd_cls();
+                  return;
+               }
             }
-            else
-            {
-               lcd_cls();
-               lcd_putstring(0, 0, "Keine (weiteren)");
-               lcd_putstring(1, 0, "Profile.");
-               wait_ms(2000);
-               lcd_cls();
-               sei();
-               return;
-            }
-            startbyte = endbyte + 1;
-            endbyte = 0;
          }
+
+         lcd_cls();
+         lcd_putstring_P(0, 0, PSTR("Keine (weiteren)"));
+         lcd_putstring_P(1, 0, PSTR("Profile."));
+         wait_ms(2000);
+         lcd_cls();
+         return;
       }
    }while(get_keys() != 2);
    while(get_keys());
@@ -1217,37 +2500,37 @@ void display_rcd()
    unsigned long dminutes_t;
    unsigned int dminutes, dhours;
 
-    lcd_putstring(0, 0, "Logwerte zeigen?");
-   lcd_putstring(1, 0, "(j/n)");
+    lcd_putstring_P(0, 0, PSTR("Logwerte zeigen?"));
+   lcd_putstring_P(1, 0, PSTR("(j/n)"));
 
     do
     {
         if(get_keys() == 3)
         {
             lcd_cls();
-         lcd_putstring(0, 0, "Anzahl TG:");
-         lcd_putnumber(1, 0, eeprom_read_byte((uint8_t*)24) + eeprom_read_byte((uint8_t*)25) * 256 + 1, -1, -1, 'l', 1);
+         lcd_putstring_P(0, 0, PSTR("Anzahl TG:"));
+         lcd_putnumber(1, 0, log_dives + 1, -1, -1, 'l', 1);
          while(get_keys() != 2);
          while(get_keys());
 
          lcd_cls();
-         lcd_putstring(0, 0, "Ges. Tauchzeit:");
+         lcd_putstring_P(0, 0, PSTR("Ges. Tauchzeit:"));
 
-         dminutes_t = eeprom_read_byte((uint8_t*)26) + eeprom_read_byte((uint8_t*)27) * 256;
+         dminutes_t = log_minutes;
          dhours = dminutes_t / 60;
          dminutes = dminutes_t - dhours * 60;
 
          xpos = lcd_putnumber(1, 0, dhours, -1, -1, 'l', 1) + 1;
-         lcd_putstring(1, xpos, "Std.");
+         lcd_putstring_P(1, xpos, PSTR("Std."));
          xpos = lcd_putnumber(1, 8, dminutes, -1, -1, 'l', 1) + 9;
-         lcd_putstring(1, xpos, "Min.");
+         lcd_putstring_P(1, xpos, PSTR("Min."));
             while(get_keys() != 2);
          while(get_keys());
 
          lcd_cls();
-         lcd_putstring(0, 0, "Max. Tiefe:");
-         xpos = lcd_putnumber(1, 0, eeprom_read_byte((uint8_t*)28) + eeprom_read_byte((uint8_t*)29) * 256, 3, 1, 'l', 1) + 1;
-         lcd_putstring(1, xpos, "m");
+         lcd_putstring_P(0, 0, PSTR("Max. Tiefe:"));
+         xpos = lcd_putnumber(1, 0, log_maxdepth, 3, 1, 'l', 1) + 1;
+         lcd_putstring_P(1, xpos, PSTR("m"));
       }
    }while(get_keys() != 2);
    while(get_keys());
@@ -1258,75 +2541,63 @@ void display_rcd()
 void display_log()
 {
 
-    unsigned int t1;
-   int startbyte = 55;
-    unsigned char xpos, ok, p_cnt = 1;
+    unsigned int t1, logbyte, dive_nr = 0xFFFF;
+    int slot;
+    unsigned char xpos;
 
     while(get_keys());
     lcd_cls();
 
-    lcd_putstring(0, 0, "TG-Daten an-");
-    lcd_putstring(1, 0, "zeigen? (j/n)");
+    lcd_putstring_P(0, 0, PSTR("TG-Daten an-"));
+    lcd_putstring_P(1, 0, PSTR("zeigen? (j/n)"));
 
     do
     {
         if(get_keys() == 3)
         {
-          cli();
-         while(1)
+         // Datensaetze vom neuesten zum aeltesten TG ueber das Verzeichnis 
+         while((slot = dir_find(dive_nr)) >= 0)
          {
+            dive_nr = dir_read(slot, DIR_NUM);
+            logbyte = dir_read(slot, DIR_POS_END);  // 230 
+
             lcd_cls();
+            lcd_putstring_P(0, 0, PSTR("TG Nr."));
+            lcd_putnumber(0, 7, dive_nr, -1, -1, 'l', 1);
+            wait_ms(1000);
 
-            // Anfang eines Datensatzes im EEPROM-Speicher suchen 
-            t1 = startbyte;
-            ok = 0;
-            while(t1 < MAX_EEPROM_ADR && !ok)
-            {
-               if(eeprom_read_byte((uint8_t*)t1) == 230)
-               {
-                  startbyte = t1;
-                  ok = 1;
-               }
-               else
-                  t1++;
-            }
+            lcd_cls();
 
-            if(startbyte && ok)
-            {
-               lcd_cls();
-               lcd_putstring(0, 0, "TG Nr.");
-               lcd_putnumber(0, 7, p_cnt++, -1, -1, 'l', 1);
-               wait_ms(1000);
+            lcd_putstring_P(0, 0, PSTR("Tauchzeit in Min."));
+            lcd_putnumber(1, 0, ee_read(prof_adr(logbyte + 1)) + ee_read(prof_adr(logbyte + 2)) * 256, -1, -1, 'l', 1);
+            wait_ms(1000);
+            lcd_cls();
 
-               lcd_cls();
+               lcd_putstring_P(0, 0, PSTR("Max. Tiefe in m"));
+            lcd_putnumber(1, 0, (ee_read(prof_adr(logbyte + 3)) + ee_read(prof_adr(logbyte + 4)) * 256) / 10, -1, -1, 'l', 1);
+            wait_ms(1000);
+            lcd_cls();
 
-               lcd_putstring(0, 0, "Tauchzeit in Min.");
-               lcd_putnumber(1, 0, eeprom_read_byte((uint8_t*)startbyte + 1) + eeprom_read_byte((uint8_t*)startbyte + 2) * 256, -1, -1, 'l', 1);
-               wait_ms(1000);
-               lcd_cls();
+            // Dekostufen zwischen 231 und 232 
+            lcd_putstring_P(0, 0, PSTR("Dekostufen"));
+            xpos = 0;
+            for(t1 = 0; t1 < MAX_DECO_STEPS && xpos < 15; t1++)
+               xpos = lcd_putnumber(1, xpos, ee_read(prof_adr(logbyte + 8 + t1)), -1, -1, 'l', 1) + 2;
+            wait_ms(2000);
 
-                  lcd_putstring(0, 0, "Max. Tiefe in m");
-               lcd_putnumber(1, 0, (eeprom_read_byte((uint8_t*)startbyte + 3) + eeprom_read_byte((uint8_t*)startbyte + 4) * 256) / 10, -1, -1, 'l', 1);
-               wait_ms(1000);
+            if(get_keys() == 2)
+            {
                lcd_cls();
-
-               lcd_putstring(0, 0, "Dekostufen");
-
-               ok = 0;
-               t1 = startbyte + 5;
-               xpos = 0;
-               while(t1 < MAX_EEPROM_ADR && t1 < startbyte + 10 && !ok)
-                {
-                   if(eeprom_read_byte((uint8_t*)t1++) == 231)
-                   {
-                      ok = 1;
-
-                     while(t1 < MAX_EEPROM_ADR && ok && eeprom_read_byte((uint8_t*)t1++) != 232)
-                        xpos = lcd_putnumber(1, xpos, eeprom_read_byte((uint8_t*)t1), -1, -1, 'l', 1) + 2;
-                   }
-                }
+               return;
             }
-          }
+         }
+
+         lcd_cls();
+         lcd_putstring_P(0, 0, PSTR("Keine (weiteren)"));
+         lcd_putstring_P(1, 0, PSTR("TG-Daten."));
+         wait_ms(2000);
+         lcd_cls();
+         return;
       }
     }while(get_keys() != 2);
    while(get_keys());
@@ -1334,90 +2605,312 @@ void display_log()
 
 }
 
-// Flash-Speicher löschen 
-// Parameter: 1: Nur Profilspeicher löschen, 2: kompletten Speicher löschen 
-void clear_flash(char erasemode)
+// Adresse im Ringspeicher der Profile (Ueberlauf an den Anfang) 
+unsigned int prof_adr(unsigned int adr)
 {
-    unsigned int t1, startadr = 0;
+    while(adr > EEPROM_PROF_END)
+        adr -= EEPROM_PROF_SIZE;
 
-    while(get_keys());
-    lcd_cls();
+    return adr;
+}
 
-   if(erasemode == 1)
-       startadr = EEPROM_PROF_START;
+// Abstand von Adresse from bis Adresse to im Ringspeicher der Profile 
+unsigned int prof_dist(unsigned int from, unsigned int to)
+{
+    if(to >= from)
+        return to - from;
 
-    // TG-Profildaten loeschen? 
-   if(startadr == EEPROM_PROF_START)
-   {
-        lcd_putstring(0, 0, "TG-Profile loe-");
-        lcd_putstring(1, 0, "schen? (j/n)");
-    }
-   else
-   {
-        lcd_putstring(0, 0, "Flashspeicher");
-        lcd_putstring(1, 0, "loeschen? (j/n)");
-   }
+    return to + EEPROM_PROF_SIZE - from;
+}
 
-    do
-    {
-        if(get_keys() == 3)
-        {
-            lcd_cls();
-            lcd_putstring(0, 0, "Loesche Byte:");
-            cli();
-            for(t1 = startadr; t1 <= MAX_EEPROM_ADR; t1++)
-            {
-                while(!eeprom_is_ready());
-                eeprom_write_byte((uint8_t*)t1, 0);
-                lcd_putnumber(1, 0, t1, -1, -1, 'l', 1);
-            }
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)30, EEPROM_PROF_START);
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)31, 0);
-            sei();
-            lcd_cls();
-            return;
-        }
-    }while(get_keys() != 2);
-    while(get_keys());
-    lcd_cls();
+// Feld eines Verzeichniseintrags lesen und schreiben 
+unsigned int dir_read(int slot, int field)
+{
+    unsigned int adr = DIR_START + slot * DIR_ENTRY_SIZE + field * 2;
 
+    return ee_read(adr) + 256 * ee_read(adr + 1);
 }
 
-// Wartezeit in Millisekunden bei fck = 8.000 MHz 
-//Warteschleife in Millisekunden
-void wait_ms(int ms)
+// Nur geaenderte Bytes schreiben 
+void dir_write(int slot, int field, unsigned int val)
 {
-   unsigned int t1;
+    unsigned int adr = DIR_START + slot * DIR_ENTRY_SIZE + field * 2;
 
-    for(t1 = 1; t1 < ms; t1++)
-      _delay_ms(1);
+    if(ee_read(adr) != (val & 0x00FF))
+    {
+        ee_put(adr, val & 0x00FF);              // LoByte 
+    }
+    if(ee_read(adr + 1) != (val & 0xFF00) / 256)
+    {
+        ee_put(adr + 1, (val & 0xFF00) / 256);  // HiByte 
+    }
 }
 
-// LEDs an PC2, 3 und 4 
-void led(char lednum, char status)
+// Eintrag des TG mit der hoechsten Nr. unterhalb von dive_nr suchen, 
+// -1 wenn es keinen gibt                                              
+int dir_find(unsigned int dive_nr)
 {
-    switch(lednum)
-   {
-       case 2: lednum = PC2;
-              break;
-       case 3: lednum = PC3;
-              break;
-       case 4: lednum = PC4;
-              break;
-   }
+    unsigned int n, n_max = 0;
+    int t1, slot = -1;
 
-    if(status)
-   {
-        //cbi(PORTC, lednum);
-      PORTC &= ~_BV(lednum);
-   }
-    else
-   {
-        //sbi(PORTC, lednum);
-      PORTC |= _BV(lednum);
-   }
+    for(t1 = 0; t1 < DIR_ENTRIES; t1++)
+    {
+        n = dir_read(t1, DIR_NUM);
+        if(n && n < dive_nr && n > n_max)
+        {
+            n_max = n;
+            slot = t1;
+        }
+    }
+
+    return slot;
+}
+
+// Eintrag fuer einen neuen TG suchen. Eintraege von TG, die der neue TG 
+// im Ringspeicher ueberschreibt, werden geloescht. Freie Eintraege       
+// werden reihum nach dem neuesten vergeben, damit sich die Schreib-     
+// zugriffe verteilen, sonst wird der aelteste Eintrag geloescht.        
+int dir_slot(unsigned int startbyte, unsigned int endbyte)
+{
+    unsigned int len, s, e, n, n_min = 0xFFFF, n_max = 0, used = 0;
+    int t1, slot, newest = -1, oldest = 0;
+
+    // Belegter Bereich relativ zum Start des neuen TG 
+    len = prof_dist(startbyte, endbyte) + DIR_LOG_LEN;
+
+    for(t1 = 0; t1 < DIR_ENTRIES; t1++)
+    {
+        n = dir_read(t1, DIR_NUM);
+        if(!n)
+            continue;
+
+        s = dir_read(t1, DIR_POS_START);
+        e = prof_adr(dir_read(t1, DIR_POS_END) + LOG_LEN(ee_read(prof_adr(s + 4))) - 1);
+        s = prof_dist(startbyte, s);
+        e = prof_dist(startbyte, e);
+        if(s < len || e < len || s > e)
+        {
+            dir_write(t1, DIR_NUM, 0);
+            continue;
+        }
+
+        used |= 1 << t1;
+        if(n > n_max)
+        {
+            n_max = n;
+            newest = t1;
+        }
+        if(n < n_min)
+        {
+            n_min = n;
+            oldest = t1;
+        }
+    }
+
+    for(t1 = 1; t1 <= DIR_ENTRIES; t1++)
+    {
+        slot = (newest + t1) % DIR_ENTRIES;
+        if(!(used & (1 << slot)))
+            return slot;
+    }
+
+    dir_write(oldest, DIR_NUM, 0);
+    return oldest;
+}
+
+// Eintrag schreiben, die Nr. zuletzt (bis dahin ist er leer). Ohne Lesen, 
+// damit nicht auf die Bytes im Schreibpuffer gewartet werden muss.       
+void dir_set(int slot, unsigned int startbyte, unsigned int endbyte, unsigned int dive_nr)
+{
+    unsigned int adr = DIR_START + slot * DIR_ENTRY_SIZE;
+
+    ee_put(adr + DIR_POS_START * 2, startbyte & 0x00FF);
+    ee_put(adr + DIR_POS_START * 2 + 1, (startbyte & 0xFF00) / 256);
+    ee_put(adr + DIR_POS_END * 2, endbyte & 0x00FF);
+    ee_put(adr + DIR_POS_END * 2 + 1, (endbyte & 0xFF00) / 256);
+    ee_put(adr + DIR_NUM * 2, dive_nr & 0x00FF);
+    ee_put(adr + DIR_NUM * 2 + 1, (dive_nr & 0xFF00) / 256);
+}
+
+// Verzeichnis aus dem Ringspeicher neu aufbauen (einmalig, wenn die Kennung 
+// fehlt, z.B. nach einem Update mit vorhandenen Profilen)                   
+void dir_rebuild(void)
+{
+    unsigned int t1, startbyte, dive_cnt, n;
+    unsigned char fmt = 0;
+
+    lcd_cls();
+    lcd_putstring_P(0, 0, PSTR("Verzeichnis..."));
+
+    for(t1 = DIR_START; t1 <= MAX_EEPROM_ADR; t1++)
+    {
+        if(ee_read(t1))
+            ee_put(t1, 0);
+    }
+    ee_flush();  // Ringspeicher danach ohne Wartezeiten lesen 
+
+    // Paare aus 229 und 230 suchen. Nr. des TG im Datensatz, bei aelteren 
+    // TG nur das LoByte, HiByte dann aus dem TG-Zaehler ergaenzen          
+    dive_cnt = ee_read(24) + 256 * ee_read(25);
+    startbyte = 0;
+    for(t1 = EEPROM_PROF_START + 5; t1 + DIR_LOG_LEN <= EEPROM_PROF_END; t1++)
+    {
+        switch(ee_read(t1))
+        {
+          case 229:
+            startbyte = t1 - 5;
+            fmt = ee_read(t1 - 1);
+            break;
+
+          case 230:
+            if(startbyte)
+            {
+                n = ee_read(t1 + 19);
+                if(fmt & PROF_FMT_TOTALS)
+                    n += 256 * ee_read(t1 + LOG_NUM_HI);
+                else
+                    n = dive_cnt - ((dive_cnt - n) & 0xFF);
+                if(n)
+                    dir_set(dir_slot(startbyte, t1), startbyte, t1, n);
+                t1 += LOG_LEN(fmt) - 1;
+            }
+            startbyte = 0;
+        }
+    }
+
+    ee_put(DIR_MAGIC_ADR, DIR_MAGIC);
+    lcd_cls();
+}
+
+// Gesamtwerte des Logbuchs und Profilzeiger aus dem Datensatz des neuesten 
+// TG holen, ohne solchen TG aus 24..31                                     
+void log_init(void)
+{
+    int slot = dir_find(0xFFFF);
+    unsigned int adr;
+
+    if(slot >= 0 && (ee_read(prof_adr(dir_read(slot, DIR_POS_START) + 4)) & PROF_FMT_TOTALS))
+    {
+        adr = dir_read(slot, DIR_POS_END);
+        log_dives = dir_read(slot, DIR_NUM);
+        log_minutes = ee_read(prof_adr(adr + LOG_MINUTES)) + 256 * ee_read(prof_adr(adr + LOG_MINUTES + 1));
+        log_maxdepth = ee_read(prof_adr(adr + LOG_MAXDEPTH)) + 256 * ee_read(prof_adr(adr + LOG_MAXDEPTH + 1));
+        eeprom_byte_count = prof_adr(adr + DIR_LOG_LEN);
+    }
+    else
+    {
+        log_dives = ee_read(24) + 256 * ee_read(25);
+        log_minutes = ee_read(26) + 256 * ee_read(27);
+        log_maxdepth = ee_read(28) + 256 * ee_read(29);
+        eeprom_byte_count = ee_read(30) + 256 * ee_read(31);
+    }
+}
+
+// Flash-Speicher löschen 
+// Parameter: 1: Nur Profilspeicher löschen, 2: kompletten Speicher löschen 
+void clear_flash(char erasemode)
+{
+    unsigned int t1, startadr = 0;
+
+    while(get_keys());
+    lcd_cls();
+
+   if(erasemode == 1)
+       startadr = EEPROM_PROF_START;
+
+    // TG-Profildaten loeschen? 
+   if(startadr == EEPROM_PROF_START)
+   {
+        lcd_putstring_P(0, 0, PSTR("TG-Profile loe-"));
+        lcd_putstring_P(1, 0, PSTR("schen? (j/n)"));
+    }
+   else
+   {
+        lcd_putstring_P(0, 0, PSTR("Flashspeicher"));
+        lcd_putstring_P(1, 0, PSTR("loeschen? (j/n)"));
+   }
+
+    do
+    {
+        if(get_keys() == 3)
+        {
+            lcd_cls();
+            lcd_putstring_P(0, 0, PSTR("Loesche Byte:"));
+
+            // Gesamtwerte stehen danach wieder bei 24..29 
+            if(erasemode == 1)
+            {
+                ee_put(24, log_dives & 0x00FF);
+                ee_put(25, (log_dives & 0xFF00) / 256);
+                ee_put(26, log_minutes & 0x00FF);
+                ee_put(27, (log_minutes & 0xFF00) / 256);
+                ee_put(28, log_maxdepth & 0x00FF);
+                ee_put(29, (log_maxdepth & 0xFF00) / 256);
+            }
+
+            for(t1 = startadr; t1 <= MAX_EEPROM_ADR; t1++)
+            {
+                ee_put(t1, 0);
+                lcd_putnumber(1, 0, t1, -1, -1, 'l', 1);
+            }
+            ee_put(30, EEPROM_PROF_START);
+            ee_put(31, 0);
+            ee_put(DIR_MAGIC_ADR, DIR_MAGIC);  // leeres Verzeichnis 
+            if(!startadr)
+                memset(&cfg, 0, sizeof(cfg));  // Vorgaben beim naechsten Start 
+            ee_flush();
+            log_init();
+            lcd_cls();
+            return;
+        }
+    }while(get_keys() != 2);
+    while(get_keys());
+    lcd_cls();
+
+}
+
+// Wartezeit in Millisekunden, das Display zeigt waehrenddessen den 
+// aktuellen Inhalt                                                 
+void wait_ms(int ms)
+{
+    lcd_flush();
+    delay_ms(ms);
+}
+
+#ifndef HOST_SIM
+// Wartezeit in Millisekunden bei fck = 8.000 MHz 
+//Warteschleife in Millisekunden (ohne Displayausgabe)
+void delay_ms(int ms)
+{
+   unsigned int t1;
+
+    for(t1 = 1; t1 < ms; t1++)
+      _delay_ms(1);
+}
+
+// LEDs an PC2, 3 und 4 
+void led(char lednum, char status)
+{
+    switch(lednum)
+   {
+       case 2: lednum = PC2;
+              break;
+       case 3: lednum = PC3;
+              break;
+       case 4: lednum = PC4;
+              break;
+   }
+
+    if(status)
+   {
+        //cbi(PORTC, lednum);
+      PORTC &= ~_BV(lednum);
+   }
+    else
+   {
+        //sbi(PORTC, lednum);
+      PORTC |= _BV(lednum);
+   }
 }
 
 
@@ -1426,37 +2919,156 @@ void led(char lednum, char status)
 int get_keys(void)
 {
     int t1;
+
+    lcd_flush();
    for(t1 = 0; t1 < 3;t1++)
      if(!bit_is_set(PINB, t1))
         return (t1 + 1);
    return 0;
 }
+#endif
+
+// Pruefsumme des Einstellungsblocks ohne das Feld crc 
+uint16_t cfg_crc(struct config *c)
+{
+    unsigned char *p = (unsigned char*) c;
+    uint16_t crc = 0xFFFF;
+    unsigned int t1;
+
+    for(t1 = sizeof(c->crc); t1 < sizeof(struct config); t1++)
+        crc = make_crc16(crc, p[t1]);
+
+    return crc;
+}
+
+// Einstellungen beim Start lesen, pruefen und uebernehmen 
+void cfg_load(void)
+{
+    struct config c;
+    unsigned char *old = (unsigned char*) &cfg;
+    unsigned int p0, pc;
+    int t1;
+
+    eeprom_read_block(&cfg, (const void*) CFG_ADR, sizeof(cfg));
+    c = cfg;
+    p0 = old[0] + old[1] * 256;
+    pc = old[14] + old[15] * 256;
+
+    if(c.version != CFG_VERSION || c.crc != cfg_crc(&c))
+    {
+        // Einzelwerte der alten Firmware, wenn sie dort je gesichert 
+        // wurden (Luftdruecke plausibel), sonst die Vorgaben          
+        if(p0 >= 660 && p0 <= 1200 && pc >= 550 && pc <= 1000)
+        {
+            c.airp0 = p0;
+            for(t1 = 0; t1 < MAXGASES; t1++)
+                c.figN2[t1] = old[t1 * 2 + 2];
+            c.f_cons = old[10];
+            c.maxppo2 = old[11];
+            c.cabinp = pc;
+            c.altitude = old[16] + old[17] * 256;
+            c.show_ppN2 = old[18];
+            c.show_settings = old[19];
+        }
+        else
+        {
+            c.airp0 = airp0 * 1000 + 0.5;
+            for(t1 = 0; t1 < MAXGASES; t1++)
+                c.figN2[t1] = figN2[t1] * 100 + 0.5;
+            c.f_cons = 12;
+            c.maxppo2 = maxppo2;
+            c.cabinp = cabinp * 1000 + 0.5;
+            c.altitude = altitude;
+            c.show_ppN2 = show_ppN2;
+            c.show_settings = show_settings;
+        }
+        memset(c.spare, 0, sizeof(c.spare));
+    }
+
+    // Wertebereiche 
+    if(c.airp0 < 660 || c.airp0 > 1200)
+        c.airp0 = 1000;
+    if(c.altitude > 6000)
+        c.altitude = 0;
+    if(c.cabinp < 550 || c.cabinp > 1000)
+        c.cabinp = 750;
+    for(t1 = 0; t1 < MAXGASES; t1++)
+    {
+        if(c.figN2[t1] > 78)
+            c.figN2[t1] = 78;
+    }
+    if(c.maxppo2 > 20 || c.maxppo2 < 10)
+        c.maxppo2 = 16;
+    if(c.f_cons < 3)
+        c.f_cons = 12;
+    if(c.f_cons > F_CONS_MAX)
+        c.f_cons = F_CONS_MAX;
+    if(c.show_ppN2 > 1)
+        c.show_ppN2 = 0;
+    if(c.show_settings > 1)
+        c.show_settings = 0;
+
+    // Geaenderte Bytes (alte Werte, neue Softwareversion) zurueckschreiben 
+    cfg_save(&c);
+
+    airp0 = c.airp0 * 0.001;
+    altitude = c.altitude;
+    cabinp = c.cabinp * 0.001;
+    for(t1 = 1; t1 < MAXGASES; t1++)  // Gas 1 ist immer Luft 
+        figN2[t1] = c.figN2[t1] * 0.01;
+    maxppo2 = c.maxppo2;
+    f_cons = c.f_cons;
+    show_ppN2 = c.show_ppN2;
+    show_settings = c.show_settings;
+}
+
+// Einstellungen sichern, nur geaenderte Bytes schreiben 
+void cfg_save(struct config *c)
+{
+    unsigned char *p = (unsigned char*) c, *q = (unsigned char*) &cfg;
+    unsigned int t1;
+
+    c->version = CFG_VERSION;
+    for(t1 = 0; t1 < 3; t1++)
+        c->swversion[t1] = softwareversion[t1];
+    c->crc = cfg_crc(c);
+
+    for(t1 = 0; t1 < sizeof(struct config); t1++)
+    {
+        if(p[t1] != q[t1])
+            ee_put(CFG_ADR + t1, p[t1]);
+    }
+    cfg = *c;
+}
 
 // Benutzereinstellungen 
 void settings(void)
 {
-    int menu_sta[MENU_ITEMS] = {900, 0, 400, 10, 3, 0, 0};         // Startwerte fuer Wertepektrum 
-    int menu_end[MENU_ITEMS] = {1100, 4000, 1000, 20, 20, 1, 1};   // Endwerte fuer Wertepektrum   
-    int menu_step[MENU_ITEMS] = {5, 100, 5, 1, 1, 1, 1};           // Inkrement                    
+    static const int menu_sta[MENU_ITEMS] PROGMEM = {900, 0, 400, 10, 3, 0, 0};         // Startwerte fuer Wertepektrum 
+    static const int menu_end[MENU_ITEMS] PROGMEM = {1100, 4000, 1000, 20, F_CONS_MAX, 1, 1};   // Endwerte fuer Wertepektrum   
+    static const int menu_step[MENU_ITEMS] PROGMEM = {5, 100, 5, 1, 1, 1, 1};           // Inkrement                    
 
     int menu_N2[3]; // Temporaere Werte fuer Stickstoff 
 
     int intv, t1;
+    int sta, end, step, digits, dec;  // Tabellenwerte des aktuellen Menuepunkts 
 
     char ch, xpos;
 
+    struct config c = cfg;
+
     int menu_tmpval[MENU_ITEMS];
-    menu_tmpval[0] = airp0 * 1000;   // Luftdruck                                                     
+    menu_tmpval[0] = cfg.airp0;      // Luftdruck                                                     
     menu_tmpval[1] = altitude;       // Hoehe ueber NN                                                
-    menu_tmpval[2] = cabinp * 1000;  // Kabinendruck Flugzeug                                         
+    menu_tmpval[2] = cfg.cabinp;     // Kabinendruck Flugzeug                                         
     menu_tmpval[3] = maxppo2;        // Max. zul. Sauerstoffpartialdruck (10facher Wert!)             
     menu_tmpval[4] = f_cons;         // Multiplikationsfaktor fuer Übersaettigungstoleranzen          
-    menu_tmpval[5] = eeprom_read_byte((uint8_t*)18);  // ppN2 nach TG-Ende anzeigen
-   menu_tmpval[6] = eeprom_read_byte((uint8_t*)19);  // Beim Starten Einstellungen anzeigen?
+    menu_tmpval[5] = show_ppN2;      // ppN2 nach TG-Ende anzeigen
+   menu_tmpval[6] = show_settings;  // Beim Starten Einstellungen anzeigen?
 
     for(t1 = 0; t1 < MAXGASES; t1++)
     {
-        menu_N2[t1] = figN2[t1] * 100;
+        menu_N2[t1] = figN2[t1] * 100 + 0.5;
     }
 
     while(get_keys());
@@ -1464,9 +3076,15 @@ void settings(void)
 
     for(t1 = 0; t1 < MENU_ITEMS; t1++)
     {
-        lcd_putstring(0, 0, menu_str[t1]);
-        xpos = lcd_putnumber(1, 0, menu_tmpval[t1], menu_digits[t1], menu_dec[t1], 'l', 1) + 1;
-        lcd_putstring(1, xpos, menu_unitstr[t1]);
+        sta = pgm_read_word(&menu_sta[t1]);
+        end = pgm_read_word(&menu_end[t1]);
+        step = pgm_read_word(&menu_step[t1]);
+        digits = (signed char) pgm_read_byte(&menu_digits[t1]);
+        dec = (signed char) pgm_read_byte(&menu_dec[t1]);
+
+        lcd_putstring_P(0, 0, menu_str[t1]);
+        xpos = lcd_putnumber(1, 0, menu_tmpval[t1], digits, dec, 'l', 1) + 1;
+        lcd_putstring_P(1, xpos, menu_unitstr[t1]);
 
         do
         {
@@ -1474,22 +3092,22 @@ void settings(void)
             if(ch == 1 || ch == 3)
             {
                 lcd_linecls(1, 15);
-                intv =  menu_tmpval[t1] / menu_step[t1];
+                intv =  menu_tmpval[t1] / step;
                 switch(ch)
                 {
                   case 3:
-                    menu_tmpval[t1] = intv * menu_step[t1] + menu_step[t1];
-                    if(menu_tmpval[t1] > menu_end[t1])
-                        menu_tmpval[t1] = menu_sta[t1] ;
+                    menu_tmpval[t1] = intv * step + step;
+                    if(menu_tmpval[t1] > end)
+                        menu_tmpval[t1] = sta;
                     break;
 
                   case 1:
-                    menu_tmpval[t1]  = intv *  menu_step[t1] - menu_step[t1];
-                    if(menu_tmpval[t1] < menu_sta[t1])
-                        menu_tmpval[t1] = menu_end[t1];
+                    menu_tmpval[t1]  = intv *  step - step;
+                    if(menu_tmpval[t1] < sta)
+                        menu_tmpval[t1] = end;
                 }
-                xpos = lcd_putnumber(1, 0, menu_tmpval[t1], menu_digits[t1], menu_dec[t1], 'l', 1) + 1;
-                lcd_putstring(1, xpos, menu_unitstr[t1]);
+                xpos = lcd_putnumber(1, 0, menu_tmpval[t1], digits, dec, 'l', 1) + 1;
+                lcd_putstring_P(1, xpos, menu_unitstr[t1]);
                 wait_ms(100);
             }
         }while(ch != 2);
@@ -1501,10 +3119,10 @@ void settings(void)
     for(t1 = 0; t1 < MAXGASES; t1++)
     {
         // N2 
-        lcd_putstring(0, 0, "Gas   N2-Anteil");
+        lcd_putstring_P(0, 0, PSTR("Gas   N2-Anteil"));
         lcd_putnumber(0, 4, t1 + 1, -1, -1, 'l', 1);
         xpos = lcd_putnumber(1, 0, menu_N2[t1], -1, -1, 'l', 1);
-        lcd_putstring(1, xpos, "%  ");
+        lcd_putstring_P(1, xpos, PSTR("%  "));
         do
         {
             ch = get_keys();
@@ -1525,10 +3143,10 @@ void settings(void)
                         menu_N2[t1] = 79;
                 }
                 xpos = lcd_putnumber(1, 0, menu_N2[t1], -1, -1, 'l', 1);
-                lcd_putstring(1, xpos, "%  ");
-                lcd_putstring(1, 4, "(Nitrox");
+                lcd_putstring_P(1, xpos, PSTR("%  "));
+                lcd_putstring_P(1, 4, PSTR("(Nitrox"));
                 xpos = lcd_putnumber(1, 12, 100 - menu_N2[t1], -1, -1, 'l', 1) + 12;
-            lcd_putstring(1, xpos, ")");
+            lcd_putstring_P(1, xpos, PSTR(")"));
             }
             wait_ms(100);
         }while(ch != 2);
@@ -1537,25 +3155,18 @@ void settings(void)
     }
 
     // Speichern? 
-    lcd_putstring(0, 0, "Sichern? (j/n)");
+    lcd_putstring_P(0, 0, PSTR("Sichern? (j/n)"));
     do
     {
         if(get_keys() == 3)
         {
-            cli();
             // Luftdruck am Tauchort 
             airp0 = menu_tmpval[0] * 0.001;
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)0, menu_tmpval[0] & 0x00FF);          // LoByte 
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)1, (menu_tmpval[0] & 0xFF00) / 256);  // HiByte 
+            c.airp0 = menu_tmpval[0];
 
             // Hoehe ueber NN 
             altitude = menu_tmpval[1];
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)16, menu_tmpval[1] & 0x00FF);          // LoByte 
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)17, (menu_tmpval[1] & 0xFF00) / 256);  // HiByte 
+            c.altitude = menu_tmpval[1];
 
             calc_airp_divesite(1); // Luftdruck am Tauchort nachberechnen 
             wait_ms(2000);
@@ -1563,47 +3174,42 @@ void settings(void)
 
             // Kabinendruck im Flugzeug 
             cabinp = menu_tmpval[2]* 0.001;
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)14, menu_tmpval[2] & 0x00FF);          // LoByte 
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)15, (menu_tmpval[2] & 0xFF00) / 256);  // HiByte 
+            nft_valid = 0;
+            c.cabinp = menu_tmpval[2];
 
             // max. ppO2 
             maxppo2 = menu_tmpval[3];
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)11, menu_tmpval[3]);
+            c.maxppo2 = menu_tmpval[3];
 
             // Konservativfaktor 
          // Anzeigen der a- und b-Werte wenn geändert 
             if(menu_tmpval[4] != f_cons)
             {
                 set_ab_values(menu_tmpval[4], 1);
-                while(!eeprom_is_ready());
-                eeprom_write_byte((uint8_t*)10, menu_tmpval[4]);
                 f_cons = menu_tmpval[4];
             }
+            c.f_cons = menu_tmpval[4];
 
             // ppN2-Anzeige nach TG 
             show_ppN2 = menu_tmpval[5];
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)18, menu_tmpval[5]);
+            c.show_ppN2 = menu_tmpval[5];
 
          // Einstellungen beim Starten anzeigen?
-            show_ppN2 = menu_tmpval[6];
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)19, menu_tmpval[6]);
+            show_settings = menu_tmpval[6];
+            c.show_settings = menu_tmpval[6];
 
             // Gase 
             for(t1 = 0; t1 < MAXGASES; t1++)
             {
                 figN2[t1] = menu_N2[t1] * 0.01;
-                while(!eeprom_is_ready());
-                eeprom_write_byte((uint8_t*)(t1 * 2 + 2), menu_N2[t1]);
+                c.figN2[t1] = menu_N2[t1];
             }
 
-            sei();
+            // Erst melden, wenn alles im EEPROM steht 
+            cfg_save(&c);
+            ee_flush();
 
-            lcd_putstring(0, 2, "Gespeichert.");
+            lcd_putstring_P(0, 2, PSTR("Gespeichert."));
          wait_ms(1000);
          lcd_cls();
          return;
@@ -1613,548 +3219,917 @@ void settings(void)
     lcd_cls();
 }
 
-// Timer 2 Ereignisroutine (autom. Aufruf 1/s) 
-ISR(SIG_OVERFLOW2)
+#ifndef HOST_SIM
+//*********************************
+// Hardwarezugriff ATmega32 (HAL)  
+//*********************************
+// Ports einrichten 
+void ports_init(void)
+{
+    // OUTPUT 
+    // Port D Bit 4-7 auf "Output" schalten (=Display=DB4-DB7) 
+    DDRD = 0xF0;
+    // Port C Bit 0 bis 4 auf "Output" schalten 
+    // LCD RS, E, LEDs 
+    DDRC = 0x3F;
+
+    DDRB = 0x00;  // Port B auf Input schalten für taster 1-3
+    PORTB = 0x07; //Interne Pull-up-Widerstände an PB0, PB1 und PB2 zuschalten
+}
+
+// Watchdog aus, wird nicht gebraucht, da Software zuverlaessig ist ;-)) 
+void watchdog_off(void)
+{
+    // Logisch '1' in WDTOE und WDE schreiben 
+    WDTCR = (1<<WDTOE) | (1<<WDE);
+    // WDT abschalten 
+    WDTCR = 0x00;
+}
+
+// Timer 2 fuer Sekundenzaehlung initialisieren: 
+// asynchron getaktet durch 32.768 kHz-Quarz,    
+// Ueberlauf TICKS_PER_S mal pro Sekunde         
+void timer_init(void)
 {
-    runseconds++;
+    TIMSK &=~((1<<TOIE2)|(1<<OCIE2));  // Disable TC2 interrupt 
+    ASSR |= (1<<AS2);                   // Timer/Counter2 auf asynchronen Betrieb mit quarz 32,768kHz schalten 
+    TCNT2 = 0x00;                        // Startwert fuer Timer2 
+    TCCR2 = 0x03;                        // Teiler ck/32 
+    while(ASSR & 0x07);                 // Warten bis ASSR-Register neu geschrieben wurde 
+    TIMSK |= (1<<TOIE2);                // Interrupt ermoeglichen 
+}
 
+void timer_reload(void)
+{
     TCNT2 = 0;       // Timerregister auf 0 
 }
 
-// AD-Wandler Ereignisroutine 
-SIGNAL(SIG_ADC)
+// Zaehlerstand von Timer 2 (1024 Hz) 
+unsigned char timer_count(void)
+{
+    return TCNT2;
+}
+
+// Mikrocontroller bis runseconds = until in Energiesparmodus schalten 
+void power_save(unsigned long until)
+{
+    // SIG_EEPROM_READY und der AD-Wandler laufen nur im Idle-Modus: 
+    // solange der Schreibpuffer nicht leer ist oder eine Messreihe  
+    // laeuft dort, sonst im Power-Save-Modus bis zum naechsten      
+    // Timerueberlauf warten, bis der Termin erreicht ist           
+    // (der Befehl nach sei() laeuft noch vor jedem Interrupt)       
+    sleep_enable();
+    for(;;)
+    {
+        cli();
+        if(runseconds >= until)
+            break;
+        if(ee_head == ee_tail && !adc_busy)
+            set_sleep_mode(SLEEP_MODE_PWR_SAVE);
+        else
+            set_sleep_mode(SLEEP_MODE_IDLE);
+        sei();
+        sleep_cpu();
+    }
+    sei();
+    sleep_disable();
+}
+
+// Wandlung auf Kanal channel starten, Ergebnis kommt ueber SIG_ADC 
+void adc_start(char channel)
+{
+    ADMUX = 64 + 128 + channel; // Interne Referenz auf 2,56V und Kanal aktivieren 
+    ADCSRA = 206;   // Einschalten, Wandlung starten, Interrupt, Takt / 64 
+}
+
+// AD-Wandler (und Referenz) aus 
+void adc_off(void)
+{
+    ADCSRA = 0;
+}
+
+// Mit gesperrten Interrupts aufrufen: bis zum naechsten Interrupt im 
+// ADC-Noise-Reduction-Modus schlafen                                 
+void adc_sleep(void)
+{
+    set_sleep_mode(SLEEP_MODE_ADC);
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+}
+
+// Wandlungsergebnis lesen (nur in SIG_ADC) 
+int adc_read(void)
 {
     unsigned char lo, hi;
 
     lo = ADCL;
     hi = ADCH;
 
-    adc_val = hi * 256 + lo;
-   switch(adc_mode)
-   {
-      case 0: depth = adc_val;
-     break;
-     case 1: temp = (adc_val - 394.6344) / 2.9656;
-             // temp = adc_val; //Test zur Ausgabe des ADC-Wertes
-
-     break;
-     case 2: accu_voltage = (double) adc_val / 69;
-             //accu_voltage = adc_val; //Test zur Ausgabe des ADC-Wertes
-     break;
-   }
+    return hi * 256 + lo;
 }
 
-void eeprom_store_byte(char eeprom_val)
+// EE_RDY-Interrupt ein- und ausschalten 
+void ee_rdy_on(void)
 {
-    if(eeprom_byte_count < EEPROM_PROF_START || eeprom_byte_count > MAX_EEPROM_ADR)
-        eeprom_byte_count = EEPROM_PROF_START;
-
-    cli();
-    while(!eeprom_is_ready());
-    eeprom_write_byte((uint8_t*)eeprom_byte_count++, eeprom_val);
-    sei();
+    EECR |= (1<<EERIE);
 }
 
-int main()
+void ee_rdy_off(void)
 {
-    unsigned long seconds_old1, seconds_old2, seconds_old3;
-   unsigned long subseconds = 0;
-    unsigned char do_record_depth = 0; // Intervallschalter fuer Profilaufzeichnung 
-   unsigned char info_mode = 0;       // Definieren, was angezeigt werden soll     
-    unsigned char nft = 0;             // Flugverbotszeit                           
-   unsigned char is_deco;
-    char xpos;
-   unsigned int cur_comp = 0;
-   char max_info_mode;
-   unsigned long surf_hrs, surf_mins;
+    EECR &= ~(1<<EERIE);
+}
 
-    int t1;
+// Stack bemalen: laeuft im Startcode (.init3) nach dem Setzen des 
+// Stackzeigers, vor dem Laden von .data und .bss. In einer naked-   
+// Funktion ist nur reines Assembler sicher (C-Code koennte einen     
+// Stackrahmen anlegen, den es hier nicht gibt): Z = _end, X = SP,   
+// bis Z == SP mit STACK_PAINT fuellen.                              
+#define STACK_STR(x) STACK_STR2(x)
+#define STACK_STR2(x) #x
+extern unsigned char _end;  // Ende von .bss (Linker) 
+
+void stack_paint(void) __attribute__((naked, used, section(".init3")));
+void stack_paint(void)
+{
+    __asm__ __volatile__ (
+        "    ldi r30, lo8(_end)           \n"
+        "    ldi r31, hi8(_end)           \n"
+        "    in r26, __SP_L__             \n"
+        "    in r27, __SP_H__             \n"
+        "    ldi r24, " STACK_STR(STACK_PAINT) "\n"
+        "    rjmp 2f                      \n"
+        "1:  st Z+, r24                   \n"
+        "2:  cp r30, r26                  \n"
+        "    cpc r31, r27                 \n"
+        "    brlo 1b                      \n");
+}
 
-    // Ports einrichten 
-    // OUTPUT 
-    // Port D Bit 4-7 auf "Output" schalten (=Display=DB4-DB7) 
-    DDRD = 0xF0;
-    // Port C Bit 0 bis 4 auf "Output" schalten 
-    // LCD RS, E, LEDs 
-    DDRC = 0x3F;
+// Nie benutzte Bytes zwischen Ende von .bss und Stack 
+unsigned int stack_unused(void)
+{
+    unsigned char *p = &_end;
 
-    DDRB = 0x00;  // Port B auf Input schalten für taster 1-3
-    PORTB = 0x07; //Interne Pull-up-Widerstände an PB0, PB1 und PB2 zuschalten
+    while(p < (unsigned char*) SP && *p == STACK_PAINT)
+        p++;
 
-    // Alle LEDs aus 
-    for(t1 = 2; t1 < 4; t1++)
-        led(t1, 0);
+    return p - &_end;
+}
+#endif
 
-    // Mit LCD-Initialisierung 0.2 s warten bis PowerUp von MC OK 
-    wait_ms(200);
-    lcd_init();
-    lcd_putstring(0, 4, "SBTC 3b");
+// Timer 2 Ereignisroutine (autom. Aufruf TICKS_PER_S mal pro Sekunde): 
+// zur vollen Sekunde alle Kanaele, sonst nur den Drucksensor messen    
+ISR(SIG_OVERFLOW2)
+{
+    timer_reload();
 
-    // Softwareversion 
-    for(t1 = 0; t1 < 3; t1++)
+    if(++ticks == TICKS_PER_S)
     {
-        if(softwareversion[t1] != eeprom_read_byte((uint8_t*)21 + t1))
-        {
-            while(!eeprom_is_ready());
-            eeprom_write_byte((uint8_t*)21 + t1, softwareversion[t1]);
-        }
+        ticks = 0;
+        runseconds++;
     }
 
-    lcd_putstring(1, 5, "V .");
-    lcd_putnumber(1, 6, softwareversion[0], -1, -1, 'l', 1);
-    lcd_putnumber(1, 8, softwareversion[1], 2, -1, 'l', 1);
-    lcd_putchar(1, 10, softwareversion[2]);
+    if(!adc_busy)
+        adc_burst(ticks ? ADC_DEPTH : ADC_CHANNELS - 1);
+}
 
-    // Watchdog aus, wird nicht gebraucht, da Software zuverlaessig ist ;-)) 
-    // Logisch '1' in WDTOE und WDE schreiben 
-    WDTCR = (1<<WDTOE) | (1<<WDE);
-    // WDT abschalten 
-    WDTCR = 0x00;
-    wait_ms(INITWAIT * 2);
+// AD-Wandler Ereignisroutine: Wandlungen summieren, naechste starten 
+SIGNAL(SIG_ADC)
+{
+    int val = adc_read();
 
-   // ppN2 anzeigen
-    show_settings = eeprom_read_byte((uint8_t*)19);
-    if (show_settings   != 1 && show_settings != 0)
-        show_settings = 0;
+    if(adc_cnt >= 0)
+        adc_sum += val;
+    if(++adc_cnt < ADC_OVERSAMPLE)
+    {
+        adc_start(adc_ch);
+        return;
+    }
 
-   // Konservativ-Faktor auf 5 setzen (^= *= 1.2) 
-    f_cons = 12;
-    set_ab_values(f_cons, 0);
+    adc_result[adc_ch] = adc_sum / (ADC_OVERSAMPLE / 4);
+    adc_done |= 1 << adc_ch;
+    adc_sum = 0;
+    if(adc_ch == ADC_DEPTH)
+        depth_filter(adc_result[ADC_DEPTH]);
 
-    if(show_settings)
-   {
-      // Umgebungsluftdruck 
-      lcd_cls();
-      airp0 = (eeprom_read_byte((uint8_t*)0) + eeprom_read_byte((uint8_t*)1) * 256) * 0.001;  // Luftdruck 
-      if(airp0 < 0.66 || airp0 > 1.2)
-         airp0 = 1;
-      lcd_putstring(0, 0, menu_str[0]);
-      xpos = lcd_putnumber(1, 0, airp0 * 1000, -1, -1, 'l', 1) + 1;
-      lcd_putstring(1, xpos, menu_unitstr[0]);
+    if(++adc_ch <= adc_last)
+    {
+        adc_cnt = -1;
+        adc_start(adc_ch);
+    }
+    else
+    {
+        adc_off();
+        adc_busy = 0;
+    }
+}
 
-      // Hoehe ueber NN 
-      wait_ms(INITWAIT);
-      lcd_cls();
-      altitude = (eeprom_read_byte((uint8_t*)16) + eeprom_read_byte((uint8_t*)17) * 256);  // Hoehe ueber NN in m 
-      if(altitude < 0 || altitude > 6000)
-         altitude = 0;
-      lcd_putstring(0, 0, menu_str[1]);
-      xpos = lcd_putnumber(1, 0, altitude , -1, -1, 'l', 1) + 1;
-      lcd_putstring(1, xpos, menu_unitstr[1]);
+// Messpunkt des Profils speichern. Kleine Differenzen werden zu zweit oder 
+// zu dritt, Messpunkte ohne Aenderung gesammelt geschrieben.               
+void prof_store_depth(int new_depth)
+{
+    int d;
 
-      // Luftdruck am Tauchort 
-      calc_airp_divesite(1);
+    if(new_depth < 0)
+        new_depth = 0;
+    d = new_depth - prof_depth;
+    prof_depth = new_depth;
 
-      // Kabinendruck im Flugzeug 
-      wait_ms(INITWAIT);
-      lcd_cls();
-      cabinp = (eeprom_read_byte((uint8_t*)14) + eeprom_read_byte((uint8_t*)15) * 256) * 0.001;  // Wert aus EEPROM lesen 
-      if(cabinp < 0.55 || cabinp > 1)
-         cabinp = 0.75;
-      lcd_putstring(0, 0, menu_str[2]);
-      xpos = lcd_putnumber(1, 0, cabinp * 1000, -1, -1, 'l', 1) + 1;
-      lcd_putstring(1, xpos, menu_unitstr[2]);
+    if(!d && !prof_buf_cnt)
+    {
+        if(++prof_zero == PROF_RUN_MAX)
+            prof_flush_zero();
+        return;
+    }
+    prof_flush_zero();
+    prof_put(d);
+}
 
-      // N2- und He-Anteile in den 4 Gasen 
-      wait_ms(INITWAIT);
-      figN2[0] = FN2;
-      show_gas(0);
-      wait_ms(INITWAIT);
+// Gesammelte Messpunkte ohne Aenderung schreiben, bis zu zwei werden mit 
+// den folgenden Messpunkten zusammengefasst                              
+void prof_flush_zero(void)
+{
+    if(prof_zero >= 3)
+        eeprom_store_byte(PROF_RUN + prof_zero);
+    else
+        for(; prof_zero; prof_zero--)
+            prof_put(0);
+    prof_zero = 0;
+}
 
-      for(t1 = 1; t1 < MAXGASES; t1++)
-      {
-         figN2[t1] = eeprom_read_byte((uint8_t*)(t1 * 2 + 2)) * 0.01;
-         if(figN2[t1] < 0 || figN2[t1] > 0.78)
-            figN2[t1] = 0.78;
+// Differenz zum vorherigen Messpunkt schreiben oder zurueckhalten 
+void prof_put(int d)
+{
+    if(d < -3 || d > 3)
+    {
+        prof_flush();
+        if(d >= -22 && d <= 22)
+            eeprom_store_byte(PROF_SINGLE + d);
+        else
+        {
+            eeprom_store_byte(PROF_ABS);
+            eeprom_store_byte(prof_depth / 200);
+            eeprom_store_byte(prof_depth % 200);
+        }
+        return;
+    }
 
-         show_gas(t1);
-         wait_ms(INITWAIT);
-      }
+    if(prof_buf_cnt == 2)
+    {
+        if(prof_buf[0] >= -2 && prof_buf[0] <= 2 && prof_buf[1] >= -2 && prof_buf[1] <= 2 && d >= -2 && d <= 2)
+        {
+            eeprom_store_byte(PROF_TRIPLE + (prof_buf[0] + 2) * 25 + (prof_buf[1] + 2) * 5 + d + 2);
+            prof_buf_cnt = 0;
+            return;
+        }
+        eeprom_store_byte(PROF_PAIR + (prof_buf[0] + 3) * 7 + prof_buf[1] + 3);
+        prof_buf_cnt = 0;
+    }
+    prof_buf[prof_buf_cnt++] = d;
+}
 
-      // maxppo2 
-      maxppo2 = eeprom_read_byte((uint8_t*)11);
-      if(maxppo2 > 20 || maxppo2 < 10)
-         maxppo2 = 16;
+// Zurueckgehaltene Messpunkte schreiben (vor Ereignissen und am TG-Ende) 
+void prof_flush(void)
+{
+    prof_flush_zero();
+    if(prof_buf_cnt == 2)
+        eeprom_store_byte(PROF_PAIR + (prof_buf[0] + 3) * 7 + prof_buf[1] + 3);
+    else if(prof_buf_cnt)
+        eeprom_store_byte(PROF_SINGLE + prof_buf[0]);
+    prof_buf_cnt = 0;
+}
 
-      lcd_putstring(0, 0, menu_str[3]);
-      lcd_putnumber(1, 0, maxppo2, 2, 1, 'l', 1);
-      lcd_putstring(1, 4, menu_unitstr[3]);
+// Ereignis (223..227) ins Profil schreiben 
+void prof_store_marker(unsigned char marker)
+{
+    prof_flush();
+    eeprom_store_byte(marker);
+}
 
-      wait_ms(INITWAIT);
-      lcd_cls();
+// Byte in den Schreibpuffer stellen (im Hauptprogramm, im PC-Modus auch 
+// in SIG_UART_RECV). Bei vollem Puffer wird das aelteste Byte hier     
+// geschrieben, das kann bis zu 8.5 ms dauern.                         
+void ee_put(unsigned int adr, unsigned char val)
+{
+    unsigned char head = (ee_head + 1) & EE_QUEUE_MASK;
+    unsigned char fill;
 
-      // ppN2 anzeigen 
-      show_ppN2 = eeprom_read_byte((uint8_t*)18);
-      if (show_ppN2  != 1 && show_ppN2 != 0)
-         show_ppN2  = 0;
-      lcd_putstring(0, 0, menu_str[5]);
-      if(show_ppN2 )
-         lcd_putstring(1, 0, "an");
-      else
-         lcd_putstring(1, 0, "aus");
+    if(head == ee_tail)
+    {
+        ee_rdy_off();
+        eeprom_write_byte((uint8_t*)ee_queue_adr[ee_tail], ee_queue_val[ee_tail]);
+        ee_tail = (ee_tail + 1) & EE_QUEUE_MASK;
+    }
 
-      wait_ms(INITWAIT);
-      lcd_cls();
+    ee_queue_adr[ee_head] = adr;
+    ee_queue_val[ee_head] = val;
+    ee_head = head;
 
-      //Konservativfaktor
-      lcd_putstring(0, 0, menu_str[4]);
-      lcd_putnumber(1, 0, f_cons, menu_digits[4], menu_dec[4], 'l', 1);
-      wait_ms(INITWAIT);
-   }
+    fill = (head - ee_tail) & EE_QUEUE_MASK;
+    if(fill > ee_queue_max)
+        ee_queue_max = fill;
 
-    curgas = 0;
+    ee_rdy_on();
+}
 
-    lcd_cls();
+// Byte lesen, noch nicht geschriebene Werte kommen aus dem Puffer 
+unsigned char ee_read(unsigned int adr)
+{
+    unsigned char t1 = ee_head, n = (ee_head - ee_tail) & EE_QUEUE_MASK;
+    unsigned char val;
 
-    // Timer 2 fuer Sekundenzaehlung initialisieren 
-    // (asynchron getaktet durch 32.768 kHz-Quarz)  
-    TIMSK &=~((1<<TOIE2)|(1<<OCIE2));  // Disable TC2 interrupt 
-    ASSR |= (1<<AS2);                   // Timer/Counter2 auf asynchronen Betrieb mit quarz 32,768kHz schalten 
-    TCNT2 = 0x00;                        // Startwert fuer Timer2 
-    TCCR2 = 0x05;                        // Teiler ck/128 
-    while(ASSR & 0x07);                 // Warten bis ASSR-Register neu geschrieben wurde 
-    TIMSK |= (1<<TOIE2);                // Interrupt ermoeglichen 
+    // Neuester Eintrag zuerst. Schreibt SIG_EEPROM_READY einen Eintrag 
+    // waehrenddessen, bleibt er im Puffer stehen.                      
+    while(n--)
+    {
+        t1 = (t1 - 1) & EE_QUEUE_MASK;
+        if(ee_queue_adr[t1] == adr)
+            return ee_queue_val[t1];
+    }
 
-    sei();
+    // eeprom_read_byte() wartet einen laufenden Schreibzugriff ab, bis 
+    // zum Lesen darf SIG_EEPROM_READY keinen neuen beginnen            
+    ee_rdy_off();
+    val = eeprom_read_byte((uint8_t*)adr);
+    if(ee_head != ee_tail)
+        ee_rdy_on();
 
-    seconds_old1 = runseconds - 10;
-    seconds_old2 = runseconds;
-    seconds_old3 = runseconds;
+    return val;
+}
 
+// Warten, bis alle Bytes im EEPROM stehen (nicht in Interruptroutinen) 
+void ee_flush(void)
+{
+    while(ee_head != ee_tail)
+        wait_ms(2);
+    while(!eeprom_is_ready());
+}
 
-    for(;;) // Endlosschleife fuer period. Aufgaben (Druckmessung, Dekorechnung, etc.) Periode: 1/s 
+// EEPROM bereit: naechstes Byte aus dem Schreibpuffer schreiben 
+SIGNAL(SIG_EEPROM_READY)
+{
+    if(ee_tail == ee_head)
     {
-        get_dsensor();   // Sensorabfrage Drucksensor          
+        ee_rdy_off();
+        return;
+    }
 
-        calc_ppo2(1);    // ppO2 pruefen                       
+    eeprom_write_byte((uint8_t*)ee_queue_adr[ee_tail], ee_queue_val[ee_tail]);
+    ee_tail = (ee_tail + 1) & EE_QUEUE_MASK;
+}
 
-        if(!depth && !surfaced && dphase)
-        {
-            eeprom_store_byte(227); // "Aufgetaucht" ins Log schreiben 
-            surfaced = 1;
-        }
+void eeprom_store_byte(char eeprom_val)
+{
+    if(eeprom_byte_count < EEPROM_PROF_START || eeprom_byte_count > EEPROM_PROF_END)
+        eeprom_byte_count = EEPROM_PROF_START;
 
-        if(temp < temp_min)
-            temp_min = temp;
+    ee_put(eeprom_byte_count++, eeprom_val);
+}
 
-        if(depth > SWITCHDEPTH)
-        {
-            surfaced = 0;
-         subseconds++;
-
-            if(!dphase && subseconds > 10) // TG beginnt wenn 10 Sekunden ausreichend abgetaucht wurde.
-            {                                // => Es wird auf "Tauchphase" umgeschaltet.
-                maxdepth = 0;
-                diveseconds = 0;
-                temp_min = 100;
-                deco_minutes_total = 0;
-                rcd_deco_minutes_total = 0;
-
-            for(t1= 0; t1 < MAX_DECO_STEPS; t1++)
-                rcd_decotime[t1] = 0;
-                ndt_runout = 0;
-                cns_dive = 0;
-                temp_low = 0;
+// Tiefe und ppO2 (jede Sekunde) 
+void task_sensors(void)
+{
+    BENCH_SECTION(BENCH_DSENSOR);
+    get_dsensor();   // Sensorabfrage Drucksensor          
 
-                lcd_cls();
+    BENCH_SECTION(BENCH_PPO2);
+    calc_ppo2(1);    // ppO2 pruefen                       
+    BENCH_SECTION(BENCH_LOOP);
+}
 
-                // Neues TG-Profil im Ringspeicher anlegen, Startpunkt suchen 
-                eeprom_byte_count = eeprom_read_byte((uint8_t*)30) + 256 * eeprom_read_byte((uint8_t*)31);
+// TG-Phase verfolgen, zu Beginn und Ende des TG das Logbuch schreiben 
+// (jede Sekunde)                                                      
+void task_dive(void)
+{
+    static unsigned long subseconds = 0;
+    int t1, slot;
 
-                // Startsignal 
-                eeprom_store_byte(228);
+    if(!depth && !surfaced && dphase)
+    {
+        prof_store_marker(227); // "Aufgetaucht" ins Log schreiben 
+        surfaced = 1;
+    }
 
-                // Oberflaechenpause speichern 
-                eeprom_store_byte((surf_seconds / 60) & 0x00FF);          // Lo 
-                eeprom_store_byte(((surf_seconds / 60) & 0xFF00) / 256);  // Hi 
+    if(temp < temp_min)
+        temp_min = temp;
 
-                // Temperatur zu TG-Beginn 
-                eeprom_store_byte(temp);
+    if(depth > SWITCHDEPTH)
+    {
+        surfaced = 0;
+        subseconds++;
+
+        if(!dphase && subseconds > 10) // TG beginnt wenn 10 Sekunden ausreichend abgetaucht wurde.
+        {                                // => Es wird auf "Tauchphase" umgeschaltet.
+            BENCH_SECTION(BENCH_LOG);
+            maxdepth = 0;
+            diveseconds = 0;
+            temp_min = 100;
+            deco_minutes_total = 0;
+            rcd_deco_minutes_total = 0;
+            for(t1 = 0; t1 < MAX_DECO_STEPS; t1++)
+                rcd_decotime[t1] = 0;
+            ndt_runout = 0;
+            cns_dive = 0;
+            temp_low = 0;
 
-                // Aufzeichnungsintervall 
-                eeprom_store_byte(20);
+            lcd_cls();
 
-                // Indikator fuer den Beginn des TG-Profiles 
-                eeprom_store_byte(229);
+            // Neues TG-Profil im Ringspeicher anlegen (Startpunkt aus log_init() 
+            // bzw. hinter dem letzten TG)                                       
+            // Startsignal 
+            eeprom_store_byte(228);
+            dive_start_adr = eeprom_byte_count - 1;
 
-                surf_seconds = 0;
+            // Oberflaechenpause speichern 
+            eeprom_store_byte((surf_seconds / 60) & 0x00FF);          // Lo 
+            eeprom_store_byte(((surf_seconds / 60) & 0xFF00) / 256);  // Hi 
 
-            dphase = 1;
-            }
+            // Temperatur zu TG-Beginn 
+            eeprom_store_byte(temp);
+
+            // Aufzeichnungsintervall und Profilformat 
+            eeprom_store_byte(PROF_FMT_DELTA | PROF_FMT_TOTALS | PROF_INTERVAL);
+
+            // Indikator fuer den Beginn des TG-Profiles 
+            eeprom_store_byte(229);
+            prof_depth = 0;
+            prof_zero = 0;
+            prof_buf_cnt = 0;
+            task_due[TASK_PROFILE] = runseconds + PROF_INTERVAL;
 
-         diveseconds++;
+            surf_seconds = 0;
+
+        dphase = 1;
+            BENCH_SECTION(BENCH_LOOP);
         }
-        else // Taucher an der Oberflaeche
-        {
-          subseconds = 0;
 
-            if(surf_seconds > SURF_SECONDS_MAX && !deco_minutes_total)    // TG beendet 
+     diveseconds++;
+    }
+    else // Taucher an der Oberflaeche
+    {
+      subseconds = 0;
+
+        if(surf_seconds > SURF_SECONDS_MAX && !deco_minutes_total)    // TG beendet 
+        {
+            if(dphase)
             {
-                if(dphase)
-                {
-                    // EEPROM aktualisieren... 
-                    // TG-Zaehler um 1 erhoehen 
-                    t1 = eeprom_read_byte((uint8_t*)24) + 256 * eeprom_read_byte((uint8_t*)25) + 1; // Alten Wert holen 
-                    cli();
-                    while(!eeprom_is_ready());
-                    eeprom_write_byte((uint8_t*)24, t1 & 0x00FF);         // LoByte 
-                    while(!eeprom_is_ready());
-                    eeprom_write_byte((uint8_t*)25, (t1 & 0xFF00) / 256); // HiByte 
-
-                    // Gesamttauchzeit erhoehen 
-                    t1 = eeprom_read_byte((uint8_t*)26) + 256 * eeprom_read_byte((uint8_t*)27) + (int)(diveseconds / 60); // Alten Wert holen und veraendern 
-                    while(!eeprom_is_ready());
-                    eeprom_write_byte((uint8_t*)26, t1 & 0x00FF);           // LoByte 
-                    while(!eeprom_is_ready());
-                    eeprom_write_byte((uint8_t*)27, (t1 & 0xFF00) / 256);  // HiByte 
-
-                    // Maximaltiefe evtl. erhoehen 
-                    if(maxdepth > eeprom_read_byte((uint8_t*)28) + 256 * eeprom_read_byte((uint8_t*)29)) // Alten Wert holen 
-                    {
-                        while(!eeprom_is_ready());
-                        eeprom_write_byte((uint8_t*)28, maxdepth & 0x00FF);         // LoByte 
-                        while(!eeprom_is_ready());
-                        eeprom_write_byte((uint8_t*)29, (maxdepth & 0xFF00) / 256); // HiByte 
-                    }
-                    sei();
-
-                    // Indikator fuer Profilende 
-                    eeprom_store_byte(230);
-
-                    // Tauchzeit in [min] 
-                    eeprom_store_byte((diveseconds / 60) & 0x00FF);          // Lo 
-                    eeprom_store_byte(((diveseconds / 60) & 0xFF00) / 256);  // Hi 
-
-                    // Max. Tiefe in [dm] 
-                    eeprom_store_byte(maxdepth  & 0x00FF);          // Lo 
-                    eeprom_store_byte((maxdepth  & 0xFF00) / 256); // Hi 
-
-                    // Min. Temperatur 
-                    eeprom_store_byte(temp_min);
-
-                    // Temperatur auf max. Tauchtiefe 
-                    eeprom_store_byte(temp_maxdepth);
-
-                    // Dekostufen 
-                    eeprom_store_byte(231);
-                    for(t1 = 0; t1 < MAX_DECO_STEPS; t1++)
-                        eeprom_store_byte(rcd_decotime[t1]);
-                    eeprom_store_byte(232);
-
-                    // Nr. des TG 
-                    eeprom_store_byte(eeprom_read_byte((uint8_t*)24) + 256 * eeprom_read_byte((uint8_t*)25));
-
-                    // Tages ZNS 
-                    eeprom_store_byte((int)cns_day  & 0x00FF);          // Lo 
-                    eeprom_store_byte(((int)cns_day & 0xFF00) / 256);  // Hi 
-
-                    // Tauchgangs-ZNS 
-                    eeprom_store_byte((int)cns_dive  & 0x00FF);        // Lo 
-                    eeprom_store_byte(((int)cns_dive & 0xFF00) / 256); // Hi 
-
-                    // OTU 
-                    eeprom_store_byte((int)otu  & 0x00FF);         // Lo  
-                    eeprom_store_byte(((int)otu & 0xFF00) / 256);  // Hi 
-
-                    // Sequenzende 
-                    eeprom_store_byte(233);
-
-                    // Speichern der letzten Adresse bei Offset 30 & 31 
-                    cli();
-                    while(!eeprom_is_ready());
-                    eeprom_write_byte((uint8_t*)30, eeprom_byte_count & 0x00FF);            // LoByte 
-                    while(!eeprom_is_ready());
-                    eeprom_write_byte((uint8_t*)31, (eeprom_byte_count & 0xFF00) / 256);   // HiByte 
-                    sei();
-                }
-                dphase = 0;
+                BENCH_SECTION(BENCH_LOG);
+                // EEPROM aktualisieren... 
+                // Zurueckgehaltene Messpunkte, danach folgt das Profilende (230) 
+                prof_flush();
+                dive_log_adr = prof_adr(eeprom_byte_count);
+
+                // Gesamtwerte des Logbuchs (maxdepth ist nie negativ, 
+                // get_dsensor() begrenzt depth auf 0..999)           
+                log_dives++;
+                log_minutes += diveseconds / 60;
+                if((unsigned int) maxdepth > log_maxdepth)
+                    log_maxdepth = maxdepth;
+
+                // Eintrag im Verzeichnis suchen, solange der Schreibpuffer noch 
+                // fast leer ist (ee_read() muesste sonst warten)                
+                slot = dir_slot(dive_start_adr, dive_log_adr);
+
+                // Indikator fuer Profilende 
+                eeprom_store_byte(230);
+
+                // Tauchzeit in [min] 
+                eeprom_store_byte((diveseconds / 60) & 0x00FF);          // Lo 
+                eeprom_store_byte(((diveseconds / 60) & 0xFF00) / 256);  // Hi 
+
+                // Max. Tiefe in [dm] 
+                eeprom_store_byte(maxdepth  & 0x00FF);          // Lo 
+                eeprom_store_byte((maxdepth  & 0xFF00) / 256); // Hi 
+
+                // Min. Temperatur 
+                eeprom_store_byte(temp_min);
+
+                // Temperatur auf max. Tauchtiefe 
+                eeprom_store_byte(temp_maxdepth);
+
+                // Dekostufen 
+                eeprom_store_byte(231);
+                for(t1 = 0; t1 < MAX_DECO_STEPS; t1++)
+                    eeprom_store_byte(rcd_decotime[t1]);
+                eeprom_store_byte(232);
+
+                // Nr. des TG (LoByte) 
+                eeprom_store_byte(log_dives & 0x00FF);
+
+                // Tages ZNS 
+                eeprom_store_byte((int)cns_day  & 0x00FF);          // Lo 
+                eeprom_store_byte(((int)cns_day & 0xFF00) / 256);  // Hi 
+
+                // Tauchgangs-ZNS 
+                eeprom_store_byte((int)cns_dive  & 0x00FF);        // Lo 
+                eeprom_store_byte(((int)cns_dive & 0xFF00) / 256); // Hi 
+
+                // OTU 
+                eeprom_store_byte((int)otu  & 0x00FF);         // Lo  
+                eeprom_store_byte(((int)otu & 0xFF00) / 256);  // Hi 
+
+                // Gesamtwerte (LOG_NUM_HI, LOG_MINUTES, LOG_MAXDEPTH) 
+                eeprom_store_byte((log_dives & 0xFF00) / 256);
+                eeprom_store_byte(log_minutes & 0x00FF);
+                eeprom_store_byte((log_minutes & 0xFF00) / 256);
+                eeprom_store_byte(log_maxdepth & 0x00FF);
+                eeprom_store_byte((log_maxdepth & 0xFF00) / 256);
+
+                // Sequenzende 
+                eeprom_store_byte(233);
+
+                // TG ins Verzeichnis eintragen (zuletzt, der Schreibpuffer 
+                // haelt die Reihenfolge ein). Bis dahin gilt log_init()  
+                // noch der vorherige TG als neuester.                    
+                dir_set(slot, dive_start_adr, dive_log_adr, log_dives);
+                BENCH_SECTION(BENCH_LOOP);
             }
-            surf_seconds++;
+            dphase = 0;
         }
+        surf_seconds++;
+    }
+}
 
-        // Informationen der OFP alle 2 sec. wechseln 
-        if(!dphase && !deco_minutes_total) // Bei WT = 0 m, 0 Deco und 5 min. ausgetaucht umschalten 
-        {                                   // auf Anzeige der TG-Daten in der Zeile 1 
-            if(runseconds > seconds_old3 + 2)
-            {
-                switch(info_mode)
-                {
-                  case 0:
-                    lcd_linecls(1, 10);
-               lcd_putstring(1, 0, "OFP: ");
-               surf_hrs = surf_seconds / 3600; // (1/60)²     
-               surf_mins = (surf_seconds - surf_hrs * 3600) / 60;
-                    xpos = lcd_putnumber(1, 5, surf_hrs, 2, -1, 'l', 1) + 5;
-                    lcd_putstring(1, xpos++, ":");
-               xpos = lcd_putnumber(1, xpos, surf_mins, 2, -1, 'l', 1) + 5;
-                    break;
-
-                  case 1:
-                    nft = calc_no_fly_time();
-                    if(nft)
-                    {
-                        lcd_linecls(1, 10);
-                        lcd_putstring(1, 0, "FVB: ");
-                        xpos = lcd_putnumber(1, 5, nft, -1, -1, 'l', 1) + 5;
-                        lcd_putstring(1, xpos, "h");
-                    }
-                    break;
-
-                  case 2:
-                    if(cns_dive)
-                    {
-                        lcd_linecls(1, 10);
-                        lcd_putstring(1, 0, "ZNS TG: ");
-                        xpos = lcd_putnumber(1, 8, cns_dive, -1, -1, 'l', 1) + 8;
-                        lcd_putstring(1, xpos, "%");
-                    }
-                    break;
-
-                  case 3:
-                    if(cns_day)
-                    {
-                        lcd_linecls(1, 10);
-                        lcd_putstring(1, 0, "ZNS D: ");
-                        xpos = lcd_putnumber(1, 7, cns_day, -1, -1, 'l', 1) + 7;
-                        lcd_putstring(1, xpos, "%");
-                    }
-                    break;
+// Informationen der OFP alle 3 sec. wechseln 
+void task_display(void)
+{
+    static unsigned char info_mode = 0;  // Definieren, was angezeigt werden soll     
+    static unsigned int cur_comp = 0;
+    unsigned int nft;                    // Flugverbotszeit [min]                     
+    unsigned char is_deco;
+    char xpos;
+    char max_info_mode;
+    unsigned long surf_hrs, surf_mins;
+    int t1;
 
-                  case 4:
-                    if(otu)
-                    {
-                        lcd_linecls(1, 10);
-                        lcd_putstring(1, 0, "OTU: ");
-                        xpos = lcd_putnumber(1, 5, otu, -1, -1, 'l', 1) + 5;
-                        lcd_putstring(1, xpos, "%");
-                    }
-                    break;
+    if(!dphase && !deco_minutes_total) // Bei WT = 0 m, 0 Deco und 5 min. ausgetaucht umschalten 
+    {                                   // auf Anzeige der TG-Daten in der Zeile 1 
+        BENCH_SECTION(BENCH_DISPLAY);
+        switch(info_mode)
+        {
+          case 0:
+            lcd_linecls(1, 10);
+       lcd_putstring_P(1, 0, PSTR("OFP: "));
+       surf_hrs = surf_seconds / 3600; // (1/60)²     
+       surf_mins = (surf_seconds - surf_hrs * 3600) / 60;
+            xpos = lcd_putnumber(1, 5, surf_hrs, 2, -1, 'l', 1) + 5;
+            lcd_putstring_P(1, xpos++, PSTR(":"));
+       xpos = lcd_putnumber(1, xpos, surf_mins, 2, -1, 'l', 1) + 5;
+            break;
 
-              case 5: // Dekostufen anzeigen 
-                    {
-                   is_deco = 0;
-                   for(t1 = MAX_DECO_STEPS - 1; t1 >= 0; t1--)
-                   {
-                     if(rcd_decotime[t1] > 0)
-                      is_deco = 1;
-                    }
-
-                   if(is_deco)
-                   {
-                     lcd_linecls(1, 15);
-                     lcd_putstring(1, 0, "DEC:");
-                     xpos = 5;
-                          for(t1 = MAX_DECO_STEPS - 1; t1 >= 0; t1--)
-                     {
-                       if(rcd_decotime[t1] > 0)
-                        xpos += lcd_putnumber(1, xpos, rcd_decotime[t1], -1, -1, 'l', 1) + 1;
-                     }
-                       }
-               }
-             }
+          case 1:
+            nft = calc_no_fly_time();
+            if(nft)
+            {
+                lcd_linecls(1, 10);
+                lcd_putstring_P(1, 0, PSTR("FVB: "));
+                xpos = lcd_putnumber(1, 5, nft / 60, 2, -1, 'l', 1) + 5;
+                lcd_putstring_P(1, xpos++, PSTR(":"));
+                lcd_putnumber(1, xpos, nft % 60, 2, -1, 'l', 1);
+            }
+            break;
 
-            if(info_mode == 5)
+          case 2:
+            if(cns_dive)
             {
                 lcd_linecls(1, 10);
-                show_accu_voltage();
+                lcd_putstring_P(1, 0, PSTR("ZNS TG: "));
+                xpos = lcd_putnumber(1, 8, cns_dive, -1, -1, 'l', 1) + 8;
+                lcd_putstring_P(1, xpos, PSTR("%"));
             }
+            break;
 
-            // Anzeige ppN2 nach TG 
-            if(info_mode > 6 && show_ppN2)
+          case 3:
+            if(cns_day)
             {
-                lcd_linecls(1, 15);
-               lcd_putstring(1, 0, "ppIg");
-               xpos = lcd_putnumber(1, 4, cur_comp + 1, -1, -1, 'l', 1) + 4;
-               lcd_putstring(1, xpos, ":");
+                lcd_linecls(1, 10);
+                lcd_putstring_P(1, 0, PSTR("ZNS D: "));
+                xpos = lcd_putnumber(1, 7, cns_day, -1, -1, 'l', 1) + 7;
+                lcd_putstring_P(1, xpos, PSTR("%"));
+            }
+            break;
 
-               lcd_putnumber(1, xpos + 2, piN2[cur_comp++] * 1000, 4, 3, 'l', 1);
-               if(cur_comp > 15)
-                 cur_comp = 0;
+          case 4:
+            if(otu)
+            {
+                lcd_linecls(1, 10);
+                lcd_putstring_P(1, 0, PSTR("OTU: "));
+                xpos = lcd_putnumber(1, 5, otu, -1, -1, 'l', 1) + 5;
+                lcd_putstring_P(1, xpos, PSTR("%"));
             }
+            break;
 
-                if(show_ppN2)
-                max_info_mode = 22;
-            else
-                    max_info_mode = 6;
+      case 5: // Dekostufen anzeigen 
+            {
+           is_deco = 0;
+           for(t1 = MAX_DECO_STEPS - 1; t1 >= 0; t1--)
+           {
+             if(rcd_decotime[t1] > 0)
+              is_deco = 1;
+            }
 
-                if(info_mode < max_info_mode)
-                    info_mode++;
-                else
-                    info_mode = 0;
+           if(is_deco)
+           {
+             lcd_linecls(1, 15);
+             lcd_putstring_P(1, 0, PSTR("DEC:"));
+             xpos = 5;
+                  for(t1 = MAX_DECO_STEPS - 1; t1 >= 0; t1--)
+             {
+               if(rcd_decotime[t1] > 0)
+                xpos += lcd_putnumber(1, xpos, rcd_decotime[t1], -1, -1, 'l', 1) + 1;
+             }
+               }
+       }
+     }
 
-                seconds_old3 = runseconds;
-            }
+        if(info_mode == 5)
+        {
+            lcd_linecls(1, 10);
+            show_accu_voltage();
         }
 
-        //  Alle 10 sec. Gewebesaettigung & Dekorechnung 
-        if(runseconds >= seconds_old1 + 10)
+        // Anzeige ppN2 nach TG 
+        if(info_mode > 6 && show_ppN2)
         {
+            lcd_linecls(1, 15);
+           lcd_putstring_P(1, 0, PSTR("ppIg"));
+           xpos = lcd_putnumber(1, 4, cur_comp + 1, -1, -1, 'l', 1) + 4;
+           lcd_putstring_P(1, xpos, PSTR(":"));
+
+           lcd_putnumber(1, xpos + 2, PFLOAT(piN2[cur_comp++]) * 1000, 4, 3, 'l', 1);
+           if(cur_comp > 15)
+             cur_comp = 0;
+        }
 
-         if(dphase)
-         {
-              lcd_cls();
-         }
+        if(show_ppN2)
+            max_info_mode = 22;
+        else
+            max_info_mode = 6;
 
-            get_tsensor();
+        if(info_mode < max_info_mode)
+            info_mode++;
+        else
+            info_mode = 0;
 
-            if(temp <= 8 && !temp_low && dphase)
-            {
-                temp_low = 1;
-                set_ab_values(f_cons + 1, 0);
-            }
+        BENCH_SECTION(BENCH_LOOP);
+    }
+}
 
-            // Saettigungsrechnung 
-            calc_p_inert_gas(depth * 0.1);
-            calc_deco();
+// Alle 10 sec. Gewebesaettigung, Dekorechnung, ZNS und OTU 
+void task_tissue(void)
+{
+    BENCH_SECTION(BENCH_TSENSOR);
 
-            // TG-Profilpunkt speichern als Absolutwert in [m] in 1 Byte alle 20s 
-            if(do_record_depth >= 1)
-            {
-             eeprom_store_byte((unsigned char) (depth * .1));
-                do_record_depth = 0;
-            }
-            else
-                do_record_depth++;
+    get_tsensor();
 
-            ppo2_exceeded = 0;
-            decostep_skipped = 0;
-            seconds_old1 = runseconds;
-        }
+    if(temp <= 8 && !temp_low && dphase)
+    {
+        temp_low = 1;
+        set_ab_values(f_cons + 1, 0);
+    }
 
-        // Jede Minute ZNS und OTU berechnen 
-        if(runseconds > seconds_old2 + 60)
-        {
-            calc_cns_otu();
-            seconds_old2 = runseconds;
-        }
+    // Saettigungsrechnung 
+    BENCH_SECTION(BENCH_INERT_GAS);
+    calc_p_inert_gas(depth * 0.1);
+    BENCH_SECTION(BENCH_DECO);
+    calc_deco();
+    BENCH_SECTION(BENCH_CNS_OTU);
+    calc_cns_otu();
+
+    ppo2_exceeded = 0;
+    decostep_skipped = 0;
+    BENCH_SECTION(BENCH_LOOP);
+}
 
-        //  Tastaturabfrage ob Einstellungen gesetzt werden sollen 
-        switch(get_keys())
-        {
-          case 1: // Abfrage ob verschiedene Extrafunktionen ausgeführt werden sollen 
-          sbtc2pc();
-         display_profile();
-            clear_flash(1); // TG Profile loeschen ?
-         clear_flash(2); // kompletten Flash loeschen ?
-         display_rcd();
-         display_log();
-         break;
-
-
-          case 2: // Einstellungen 
-            settings();
-            break;
+// Dekorechnung weiterfuehren (jede Sekunde, solange sie laeuft) 
+void task_deco(void)
+{
+    BENCH_SECTION(BENCH_DECO);
+    deco_step();
+    BENCH_SECTION(BENCH_LOOP);
+}
 
-          case 3:  // Gaswechsel 
-            set_curgas();
-        }
+// TG-Profilpunkt alle PROF_INTERVAL s speichern (Format siehe       
+// PROF_FMT_DELTA), nur waehrend des TG (sonst wird der aelteste TG  
+// ueberschrieben). Der Termin beginnt mit dem TG (task_dive()).     
+void task_profile(void)
+{
+    BENCH_SECTION(BENCH_LOG);
+    if(dphase)
+        prof_store_depth(depth);
+    BENCH_SECTION(BENCH_LOOP);
+}
+
+// Geaenderte Zeichen zum Display, Tasten abfragen (jede Sekunde) 
+void task_keys(void)
+{
+    BENCH_SECTION(BENCH_LCD);
+    lcd_flush();
+
+    //  Tastaturabfrage ob Einstellungen gesetzt werden sollen 
+    BENCH_SECTION(BENCH_KEYS);
+    switch(get_keys())
+    {
+      case 1: // Abfrage ob verschiedene Extrafunktionen ausgeführt werden sollen 
+      sbtc2pc();
+     display_profile();
+        clear_flash(1); // TG Profile loeschen ?
+     clear_flash(2); // kompletten Flash loeschen ?
+     display_rcd();
+     display_log();
+     break;
+
+
+      case 2: // Einstellungen 
+        settings();
+        break;
+
+      case 3:  // Gaswechsel 
+        set_curgas();
+    }
+}
+
+// Termine ab Programmstart: die sekuendlichen Aufgaben sowie Saettigung 
+// und Deko sofort, die uebrigen nach einer Periode                     
+void sched_init(void)
+{
+    unsigned char t;
+
+    for(t = 0; t < TASKS; t++)
+        task_due[t] = runseconds + (task_period[t] > 1 ? task_period[t] : 0);
+    task_due[TASK_TISSUE] = runseconds;
+}
+
+// Faellige Aufgaben ausfuehren 
+void sched_run(void)
+{
+    unsigned char t;
+    unsigned long start;
+
+    for(t = 0; t < TASKS; t++)
+    {
+        if(runseconds < task_due[t])
+            continue;
+        if(runseconds > task_due[t])
+            task_missed[t]++;
+
+        start = sched_clock();
+        task_fn[t]();
+        start = sched_clock() - start;
+
+        if(start > 0xFFFF)
+            start = 0xFFFF;
+        if(start > task_time_max[t])
+            task_time_max[t] = start;
+        task_runs[t]++;
+        task_due[t] = runseconds + task_period[t];
+    }
+}
+
+// Fruehester Termin 
+unsigned long sched_next(void)
+{
+    unsigned long next = task_due[0];
+    unsigned char t;
+
+    for(t = 1; t < TASKS; t++)
+        if(task_due[t] < next)
+            next = task_due[t];
+
+    return next;
+}
+
+// Zeit seit Programmstart in 1/1024 s (Timer 2 zaehlt mit 1024 Hz) 
+unsigned long sched_clock(void)
+{
+    unsigned long s;
+    unsigned char t, c;
+
+    do
+    {
+        s = runseconds;
+        t = ticks;
+        c = timer_count();
+    }
+    while(s != runseconds || t != ticks);
+
+    return (s * TICKS_PER_S + t) * 256 + c;
+}
+
+int main()
+{
+    char xpos;
+    int t1;
+
+    // Ports einrichten 
+    ports_init();
+
+    // Alle LEDs aus 
+    for(t1 = 2; t1 < 5; t1++)
+        led(t1, 0);
+
+    // Mit LCD-Initialisierung 0.2 s warten bis PowerUp von MC OK 
+    wait_ms(200);
+    lcd_init();
+    lcd_putstring_P(0, 4, PSTR("SBTC 3b"));
+
+    // Einstellungen (mit Softwareversion) 
+    cfg_load();
+
+    lcd_putstring_P(1, 5, PSTR("V ."));
+    lcd_putnumber(1, 6, softwareversion[0], -1, -1, 'l', 1);
+    lcd_putnumber(1, 8, softwareversion[1], 2, -1, 'l', 1);
+    lcd_putchar(1, 10, softwareversion[2]);
+
+    // Watchdog aus 
+    watchdog_off();
+    wait_ms(INITWAIT * 2);
+
+    // TG-Verzeichnis pruefen 
+    if(ee_read(DIR_MAGIC_ADR) != DIR_MAGIC)
+        dir_rebuild();
+    log_init();
+
+   // Gespeicherter Konservativ-Faktor (Vorgabe 12 ^= *= 1.2) 
+    set_ab_values(f_cons, 0);
+
+    if(show_settings)
+   {
+      // Umgebungsluftdruck 
+      lcd_cls();
+      lcd_putstring_P(0, 0, menu_str[0]);
+      xpos = lcd_putnumber(1, 0, airp0 * 1000, -1, -1, 'l', 1) + 1;
+      lcd_putstring_P(1, xpos, menu_unitstr[0]);
+
+      // Hoehe ueber NN 
+      wait_ms(INITWAIT);
+      lcd_cls();
+      lcd_putstring_P(0, 0, menu_str[1]);
+      xpos = lcd_putnumber(1, 0, altitude , -1, -1, 'l', 1) + 1;
+      lcd_putstring_P(1, xpos, menu_unitstr[1]);
+
+      // Luftdruck am Tauchort 
+      calc_airp_divesite(1);
+
+      // Kabinendruck im Flugzeug 
+      wait_ms(INITWAIT);
+      lcd_cls();
+      lcd_putstring_P(0, 0, menu_str[2]);
+      xpos = lcd_putnumber(1, 0, cabinp * 1000, -1, -1, 'l', 1) + 1;
+      lcd_putstring_P(1, xpos, menu_unitstr[2]);
+
+      // N2- und He-Anteile in den 4 Gasen 
+      wait_ms(INITWAIT);
+      for(t1 = 0; t1 < MAXGASES; t1++)
+      {
+         show_gas(t1);
+         wait_ms(INITWAIT);
+      }
+
+      // maxppo2 
+      lcd_putstring_P(0, 0, menu_str[3]);
+      lcd_putnumber(1, 0, maxppo2, 2, 1, 'l', 1);
+      lcd_putstring_P(1, 4, menu_unitstr[3]);
+
+      wait_ms(INITWAIT);
+      lcd_cls();
+
+      // ppN2 anzeigen 
+      lcd_putstring_P(0, 0, menu_str[5]);
+      if(show_ppN2 )
+         lcd_putstring_P(1, 0, PSTR("an"));
+      else
+         lcd_putstring_P(1, 0, PSTR("aus"));
+
+      wait_ms(INITWAIT);
+      lcd_cls();
+
+      //Konservativfaktor
+      lcd_putstring_P(0, 0, menu_str[4]);
+      lcd_putnumber(1, 0, f_cons, (signed char) pgm_read_byte(&menu_digits[4]), (signed char) pgm_read_byte(&menu_dec[4]), 'l', 1);
+      wait_ms(INITWAIT);
+   }
+    else
+        calc_airp_divesite(0);  // Luftdruck am Tauchort ohne Anzeige 
+
+    curgas = 0;
+
+    lcd_cls();
+
+    // Timer 2 fuer Sekundenzaehlung initialisieren 
+    timer_init();
+
+    sei();
+
+    sched_init();
+
+    for(;;) // Endlosschleife fuer period. Aufgaben (Druckmessung, Dekorechnung, etc.) 
+    {
+        sched_run();
 
-        // Mikrocontroller fuer den Rest der Sekunde in Energiesparmodus schalten 
-        // AD-Wandler aus 
-        ADCSRA = 0;
-        // In Sleep-Mode gehen 
-        set_sleep_mode (SLEEP_MODE_PWR_SAVE);
-        sleep_mode();
+        // Mikrocontroller bis zum naechsten Termin in Energiesparmodus schalten 
+        power_save(sched_next());
     }
     return 0;
 }